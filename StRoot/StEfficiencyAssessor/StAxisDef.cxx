@@ -0,0 +1,60 @@
+#include "StAxisDef.hh"
+
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TH3D.h"
+
+namespace {
+
+  /* the nBins + 1 edges of a uniform or variable axis */
+  std::vector<double> Edges(const axisDef& axis) {
+    if (!axis.uniform())
+      return axis.edges;
+    std::vector<double> edges(axis.nBins + 1);
+    for (unsigned i = 0; i <= axis.nBins; ++i)
+      edges[i] = axis.lowEdge(i);
+    return edges;
+  }
+}
+
+TH1* axisDef::NewHistogram(const char* name, const char* title, const std::vector<axisDef>& axes) {
+  if (axes.empty() || axes.size() > 3)
+    return nullptr;
+  bool uniform = true;
+  for (size_t i = 0; i < axes.size(); ++i)
+    uniform = uniform && axes[i].uniform();
+
+  bool addDirectory = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(kFALSE);
+  TH1* hist;
+  const axisDef& x = axes[0];
+  if (uniform) {
+    // fixed bins, so the histogram is binned exactly as before variable axes
+    if (axes.size() == 1) {
+      hist = new TH1D(name, title, x.nBins, x.low, x.high);
+    } else if (axes.size() == 2) {
+      const axisDef& y = axes[1];
+      hist = new TH2D(name, title, x.nBins, x.low, x.high, y.nBins, y.low, y.high);
+    } else {
+      const axisDef& y = axes[1];
+      const axisDef& z = axes[2];
+      hist = new TH3D(name, title, x.nBins, x.low, x.high, y.nBins, y.low, y.high, z.nBins, z.low, z.high);
+    }
+  } else {
+    // ROOT has edge constructors only for all axes variable
+    std::vector<double> xEdges = Edges(x);
+    if (axes.size() == 1) {
+      hist = new TH1D(name, title, x.nBins, &xEdges[0]);
+    } else if (axes.size() == 2) {
+      std::vector<double> yEdges = Edges(axes[1]);
+      hist = new TH2D(name, title, x.nBins, &xEdges[0], axes[1].nBins, &yEdges[0]);
+    } else {
+      std::vector<double> yEdges = Edges(axes[1]);
+      std::vector<double> zEdges = Edges(axes[2]);
+      hist = new TH3D(name, title, x.nBins, &xEdges[0], axes[1].nBins, &yEdges[0],
+                      axes[2].nBins, &zEdges[0]);
+    }
+  }
+  TH1::AddDirectory(addDirectory);
+  return hist;
+}
@@ -0,0 +1,107 @@
+/* helper class for StEfficiencyAssessor
+   the binning of one histogram axis - nBins uniform bins
+   between low & high, or nBins bins between nBins + 1
+   increasing edges (e.g. pt bins that are fine at low pt
+   and coarse above 2 GeV). Every histogram InitOutput books
+   takes its axes from axisDefs
+
+   bins follow TAxis: a bin holds its low edge but not its
+   high edge, findBin() returns 0 for x < low and nBins + 1
+   for x >= high (and NaN), and bin() is findBin() - 1 - so
+   -1 below the axis and nBins above it. A uniform axis is
+   looked up in constant time, with the result of
+   TAxis::FindFixBin; variable edges by a binary search
+   without data-dependent branches
+ */
+
+#ifndef STAXISDEF__HH
+#define STAXISDEF__HH
+
+#include <vector>
+
+class TH1;
+
+struct axisDef {
+  unsigned nBins;
+  double low;
+  double high;
+  std::vector<double> edges;  // variable bins only
+  double invWidth;
+
+  axisDef() : nBins(1), low(0), high(1), invWidth(1) {}
+
+  axisDef(unsigned n, double l, double h)
+    : nBins(n), low(l), high(h), invWidth(h > l ? n / (h - l) : 0.0) {}
+
+  explicit axisDef(const std::vector<double>& e)
+    : nBins(e.size() > 1 ? e.size() - 1 : 0), low(e.empty() ? 0.0 : e.front()),
+      high(e.empty() ? 0.0 : e.back()), edges(e), invWidth(0) {}
+
+  bool uniform() const {return edges.empty();}
+
+  /* the width of a uniform bin */
+  double width() const {return (high - low) / nBins;}
+
+  /* low edge of bin i (0 - nBins - 1), or high for i = nBins */
+  double lowEdge(unsigned i) const {return uniform() ? low + i * width() : edges[i];}
+  double center(unsigned i) const  {return 0.5 * (lowEdge(i) + lowEdge(i + 1));}
+
+  /* the edges as TH1 & StFlatResultWriter take them - 0
+     for uniform bins
+   */
+  const double* edgeArray() const {return uniform() ? 0 : &edges[0];}
+
+  bool valid() const {
+    if (nBins == 0 || !(high > low))
+      return false;
+    if (uniform())
+      return true;
+    if (edges.size() != nBins + 1)
+      return false;
+    for (unsigned i = 0; i < nBins; ++i) {
+      if (!(edges[i + 1] > edges[i]))
+        return false;
+    }
+    return true;
+  }
+
+  inline int findBin(double x) const {
+    if (x < low)
+      return 0;
+    if (!(x < high))
+      return nBins + 1;
+    if (uniform()) {
+      double t = (x - low) * invWidth;
+      int bin = (int) t;
+      // within rounding of a bin edge, decide as TAxis::FindFixBin does
+      if (t - bin < 1e-9 || t - bin > 1.0 - 1e-9)
+        bin = (int) (nBins * (x - low) / (high - low));
+      return 1 + bin;
+    }
+    // edges[0] <= x < edges[nBins]: narrow to the last edge <= x. The
+    // step is a conditional move, so the loop runs log2(nBins) times
+    // whatever x is
+    const double* base = &edges[0];
+    unsigned n = nBins;
+    while (n > 1) {
+      unsigned half = n / 2;
+      base = base[half] <= x ? base + half : base;
+      n -= half;
+    }
+    return 1 + (base - &edges[0]);
+  }
+
+  inline int bin(double x) const {return findBin(x) - 1;}
+
+  bool operator==(const axisDef& rhs) const {
+    return nBins == rhs.nBins && low == rhs.low && high == rhs.high && edges == rhs.edges;
+  }
+  bool operator!=(const axisDef& rhs) const {return !(*this == rhs);}
+
+  /* a TH1D, TH2D or TH3D with these axes (1 - 3 of them),
+     owned by the caller and not attached to any directory
+   */
+  static TH1* NewHistogram(const char* name, const char* title, const std::vector<axisDef>& axes);
+};
+
+#endif // STAXISDEF__HH
@@ -0,0 +1,115 @@
+#include "StCheckpoint.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "StDifferentialCube.hh"
+#include "StHistogramWriter.hh"
+#include "StSparseHistogram.hh"
+
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1.h"
+
+#include <cstdio>
+#include <sys/stat.h>
+
+ClassImp(StCheckpoint)
+
+namespace {
+  const char* kStateName = "StCheckpoint";
+}
+
+StCheckpoint::StCheckpoint()
+  : mEvents(0), mMuEntry(0), mMuFile(""), mMatchMode(0), mMcEntry(0), mMcMatched(kFALSE),
+    mMcExhausted(kFALSE), mLastMuKey(0), mMcHeaderReads(0), mMcTrackReads(0), mMatchedEvents(0),
+    mOrphanMuEvents(0), mOrphanMcEvents(0), mUnsortedMuEvents(0), mCutCounters() {}
+
+StCheckpoint::~StCheckpoint() {
+
+}
+
+Bool_t StCheckpoint::Exists(const std::string& path) {
+  struct stat st;
+  return !path.empty() && stat(path.c_str(), &st) == 0;
+}
+
+void StCheckpoint::Remove(const std::string& path) {
+  remove(path.c_str());
+  remove((path + ".tmp").c_str());
+}
+
+Bool_t StCheckpoint::Save(const std::string& path, StHistogramWriter& writer) const {
+  // the job's current directory is left alone
+  TDirectory::TContext context(gDirectory);
+  std::string tmp = path + ".tmp";
+  TFile* file = TFile::Open(tmp.c_str(), "RECREATE");
+  if (file == nullptr || file->IsZombie()) {
+    LOG_ERROR << "checkpoint: could not create " << tmp << endm;
+    delete file;
+    return kFALSE;
+  }
+  Bool_t ok = writer.Write(file) >= 0;
+  ok = ok && file->WriteTObject(this, kStateName) > 0;
+  file->Close();
+  ok = ok && !file->TestBit(TFile::kWriteError);
+  delete file;
+
+  if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    LOG_ERROR << "checkpoint: could not write " << path << " - keeping the previous checkpoint" << endm;
+    remove(tmp.c_str());
+    return kFALSE;
+  }
+  return kTRUE;
+}
+
+StCheckpoint* StCheckpoint::Load(const std::string& path, const std::vector<TH1*>& histograms,
+                                 const std::vector<StDifferentialCube*>& cubes) {
+  if (!Exists(path))
+    return nullptr;
+  TDirectory::TContext context(gDirectory);
+  TFile* file = TFile::Open(path.c_str(), "READ");
+  if (file == nullptr || file->IsZombie()) {
+    LOG_ERROR << "checkpoint: could not open " << path << endm;
+    delete file;
+    return nullptr;
+  }
+  StCheckpoint* state = nullptr;
+  file->GetObject(kStateName, state);
+  if (state == nullptr)
+    LOG_ERROR << "checkpoint: no job state in " << path << endm;
+
+  // all histograms are checked before any is touched
+  std::vector<TH1*> saved(histograms.size(), nullptr);
+  for (size_t i = 0; state != nullptr && i < histograms.size(); ++i) {
+    saved[i] = StSparseHistogram::Get(file, histograms[i]->GetName());
+    if (saved[i] == nullptr || saved[i]->GetNcells() != histograms[i]->GetNcells()) {
+      LOG_ERROR << "checkpoint: " << histograms[i]->GetName() << " missing or binned differently in "
+                << path << endm;
+      delete state;
+      state = nullptr;
+    }
+  }
+  std::vector<StDifferentialCube*> savedCubes(cubes.size(), nullptr);
+  for (size_t i = 0; state != nullptr && i < cubes.size(); ++i) {
+    file->GetObject(cubes[i]->GetName(), savedCubes[i]);
+    if (savedCubes[i] == nullptr || !savedCubes[i]->SameBinning(*cubes[i])) {
+      LOG_ERROR << "checkpoint: " << cubes[i]->GetName() << " missing or binned differently in "
+                << path << endm;
+      delete state;
+      state = nullptr;
+    }
+  }
+  if (state != nullptr) {
+    for (size_t i = 0; i < histograms.size(); ++i)
+      histograms[i]->Add(saved[i]);
+    for (size_t i = 0; i < cubes.size(); ++i)
+      cubes[i]->Add(*savedCubes[i]);
+  }
+  for (size_t i = 0; i < saved.size(); ++i)
+    delete saved[i];
+  for (size_t i = 0; i < savedCubes.size(); ++i)
+    delete savedCubes[i];
+  file->Close();
+  delete file;
+  return state;
+}
@@ -0,0 +1,79 @@
+/* helper class for StEfficiencyAssessor
+   the state of an assessor job part way through its input:
+   the position in the muDst & miniMC chains, the match &
+   cut counters, and (in the same file) every histogram.
+   Saved every N events or M seconds, and read back by a
+   job restarted on the same lists, which continues from
+   the saved position
+
+   a checkpoint is written to <path>.tmp and renamed over
+   <path> once complete, so a job killed while writing
+   leaves the previous checkpoint intact
+ */
+
+#ifndef STCHECKPOINT__HH
+#define STCHECKPOINT__HH
+
+#include "TObject.h"
+#include "TString.h"
+
+#include <string>
+#include <vector>
+
+class TH1;
+class StDifferentialCube;
+class StHistogramWriter;
+
+class StCheckpoint : public TObject {
+
+public:
+
+  StCheckpoint();
+  ~StCheckpoint();
+
+  /* writes the histograms queued in writer, and this
+     state. Returns false if the checkpoint could not be
+     written - the previous one is then kept
+   */
+  Bool_t Save(const std::string& path, StHistogramWriter& writer) const;
+
+  /* reads the state at path, and adds the saved contents
+     of each histogram to histograms & of each cube to
+     cubes (which should be empty). Returns nullptr if there
+     is no checkpoint at path, or it does not hold every
+     histogram & cube
+   */
+  static StCheckpoint* Load(const std::string& path, const std::vector<TH1*>& histograms,
+                            const std::vector<StDifferentialCube*>& cubes);
+
+  static Bool_t Exists(const std::string& path);
+  static void Remove(const std::string& path);
+
+  // Make calls done, and the muDst chain entry (and the base
+  // name of its file) of the next event to process
+  Long64_t mEvents;
+  Long64_t mMuEntry;
+  TString  mMuFile;
+
+  // the miniMC cursor
+  Int_t     mMatchMode;
+  Long64_t  mMcEntry;
+  Bool_t    mMcMatched;
+  Bool_t    mMcExhausted;
+  ULong64_t mLastMuKey;
+
+  // match counters
+  Long64_t mMcHeaderReads;
+  Long64_t mMcTrackReads;
+  Long64_t mMatchedEvents;
+  Long64_t mOrphanMuEvents;
+  Long64_t mOrphanMcEvents;
+  Long64_t mUnsortedMuEvents;
+
+  // see StEventCuts::Counters()
+  std::vector<UInt_t> mCutCounters;
+
+  ClassDef(StCheckpoint, 1)
+};
+
+#endif // STCHECKPOINT__HH
@@ -0,0 +1,67 @@
+#include "StDenseHistogram.hh"
+
+#include "TAxis.h"
+#include "TH1.h"
+
+#include <string.h>
+
+StDenseHistogram::Axis::Axis(const TAxis* axis)
+  : axisDef(axis->GetNbins(), axis->GetXmin(), axis->GetXmax()), cells(axis->GetNbins() + 2) {
+  if (axis->GetXbins()->GetSize() > 0)
+    edges.assign(axis->GetXbins()->GetArray(), axis->GetXbins()->GetArray() + nBins + 1);
+}
+
+StDenseHistogram::StDenseHistogram(TH1* target)
+  : target_(target), dimension_(target->GetDimension()), x_(target->GetXaxis()),
+    y_(target->GetYaxis()), z_(target->GetZaxis()), stat_overflows_(TH1::GetStatOverflows()),
+    counts_(target->GetNcells(), 0), entries_(0) {
+  memset(stats_, 0, sizeof(stats_));
+}
+
+StDenseHistogram::~StDenseHistogram() {
+
+}
+
+void StDenseHistogram::Flush() {
+  if (entries_ == 0)
+    return;
+  Double_t entries = target_->GetEntries();
+
+  TArrayD* sumw2 = target_->GetSumw2N() > 0 ? target_->GetSumw2() : nullptr;
+  for (size_t cell = 0; cell < counts_.size(); ++cell) {
+    if (counts_[cell] == 0)
+      continue;
+    target_->AddBinContent(cell, counts_[cell]);
+    if (sumw2 != nullptr)
+      sumw2->fArray[cell] += counts_[cell];
+  }
+
+  // TH1::GetStats & PutStats use the layout of stats_ for every dimension:
+  // sumw, sumw2, sumwx, sumwx2 [, sumwy, sumwy2, sumwxy [, sumwz, ...]].
+  // The sums are set, not added: adding the part since the last flush
+  // would round differently for every set of flush points
+  Double_t stats[TH1::kNstat];
+  for (int i = 0; i < TH1::kNstat; ++i)
+    stats[i] = i < NStats() ? stats_[i] : 0;
+  target_->PutStats(stats);
+  target_->SetEntries(entries + entries_);
+
+  std::fill(counts_.begin(), counts_.end(), 0);
+  entries_ = 0;
+}
+
+void StDenseHistogram::Reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  entries_ = 0;
+  memset(stats_, 0, sizeof(stats_));
+}
+
+void StDenseHistogram::Sync() {
+  Double_t stats[TH1::kNstat];
+  for (int i = 0; i < TH1::kNstat; ++i)
+    stats[i] = 0;
+  target_->GetStats(stats);
+  memset(stats_, 0, sizeof(stats_));
+  for (int i = 0; i < NStats(); ++i)
+    stats_[i] = stats[i];
+}
@@ -0,0 +1,137 @@
+/* internal class for StEfficiencyAssessor
+   the fill side of a TH1/TH2/TH3 for the event loop: the
+   bins of the target histogram as one flat array of integer
+   counters, in ROOT's global bin order, filled through inline
+   axis lookups (a multiply by the precomputed inverse width
+   for uniform axes) with no virtual call. The statistics ROOT
+   keeps per fill (entries, sum w, sum wx, sum wx^2, ...) are
+   summed the same way TH1/TH2/TH3::Fill sums them
+
+   Flush() adds the counts to the target, zeroes the counters
+   and sets the statistics of the target to the sums. The sums
+   run over every fill since the last Reset(), not since the
+   last flush, so they are added up in the order of the fills
+   whatever the flushes in between - the target is identical
+   to one filled directly, and a job resumed from a checkpoint
+   (after Sync()) to one that was never interrupted. The
+   assessor flushes before every checkpoint and in Finish
+
+   unweighted fills only; the target is not owned
+ */
+
+#ifndef STDENSEHISTOGRAM__HH
+#define STDENSEHISTOGRAM__HH
+
+#include "Rtypes.h"
+
+#include "StAxisDef.hh"
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+class TH1;
+class TAxis;
+
+class StDenseHistogram {
+public:
+
+  explicit StDenseHistogram(TH1* target);
+  ~StDenseHistogram();
+
+  TH1* Target() const {return target_;}
+
+  inline void Fill(double x) {
+    int bx = x_.Bin(x);
+    ++counts_[bx];
+    ++entries_;
+    if (!InRange(x_, bx))
+      return;
+    stats_[0] += 1; stats_[1] += 1;
+    stats_[2] += x; stats_[3] += x * x;
+  }
+
+  inline void Fill(double x, double y) {
+    int bx = x_.Bin(x);
+    int by = y_.Bin(y);
+    ++counts_[bx + x_.cells * by];
+    ++entries_;
+    if (!InRange(x_, bx) || !InRange(y_, by))
+      return;
+    stats_[0] += 1; stats_[1] += 1;
+    stats_[2] += x; stats_[3] += x * x;
+    stats_[4] += y; stats_[5] += y * y;
+    stats_[6] += x * y;
+  }
+
+  inline void Fill(double x, double y, double z) {
+    int bx = x_.Bin(x);
+    int by = y_.Bin(y);
+    int bz = z_.Bin(z);
+    ++counts_[bx + x_.cells * (by + y_.cells * bz)];
+    ++entries_;
+    if (!InRange(x_, bx) || !InRange(y_, by) || !InRange(z_, bz))
+      return;
+    stats_[0] += 1; stats_[1] += 1;
+    stats_[2] += x; stats_[3] += x * x;
+    stats_[4] += y; stats_[5] += y * y;
+    stats_[6] += x * y;
+    stats_[7] += z; stats_[8] += z * z;
+    stats_[9] += x * z; stats_[10] += y * z;
+  }
+
+  /* adds everything filled since the last flush to the target */
+  void Flush();
+
+  /* zeroes the counters & the statistics, for a target that is
+     reset too
+   */
+  void Reset();
+
+  /* continues the statistics from those of the target - after
+     the target was restored from a checkpoint
+   */
+  void Sync();
+
+  /* fills since the last flush */
+  Long64_t Entries() const {return entries_;}
+
+  /* memory held by the counters */
+  size_t Bytes() const {return counts_.size() * sizeof(uint32_t);}
+
+  /* one axis of the target: bin 0 is the underflow, nBins + 1
+     the overflow, as in TAxis::FindBin
+   */
+  struct Axis : public axisDef {
+    int cells;              // nBins + 2
+
+    Axis() : cells(3) {}
+    explicit Axis(const TAxis* axis);
+
+    inline int Bin(double x) const {return findBin(x);}
+  };
+
+private:
+
+  StDenseHistogram(const StDenseHistogram&);
+  StDenseHistogram& operator=(const StDenseHistogram&);
+
+  inline bool InRange(const Axis& axis, int bin) const {
+    return stat_overflows_ || (bin > 0 && bin <= (int) axis.nBins);
+  }
+
+  int NStats() const {return dimension_ == 1 ? 4 : dimension_ == 2 ? 7 : 11;}
+
+  TH1* target_;
+  int dimension_;
+  Axis x_;
+  Axis y_;
+  Axis z_;
+  bool stat_overflows_;
+
+  std::vector<uint32_t> counts_;
+  Long64_t entries_;
+  double stats_[11];
+};
+
+#endif // STDENSEHISTOGRAM__HH
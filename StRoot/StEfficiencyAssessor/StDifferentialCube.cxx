@@ -0,0 +1,246 @@
+#include "StDifferentialCube.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "TCollection.h"
+#include "TH1.h"
+
+#include <algorithm>
+
+ClassImp(StDifferentialCube)
+
+namespace {
+
+  // a node of the block index: key, offset & next pointer, as
+  // allocated
+  const Long64_t kIndexEntryBytes = 32;
+}
+
+StDifferentialCube::StDifferentialCube()
+  : mMemoryLimit(0), mEntries(0), mDropped(0), mOutOfRange(0), mBlockCells(1),
+    mPrepared(kFALSE), mInnerBegin(0), mLastKey(-1), mLastBlock(-1) {}
+
+StDifferentialCube::StDifferentialCube(const char* name, const char* title)
+  : TNamed(name, title), mMemoryLimit(0), mEntries(0), mDropped(0), mOutOfRange(0), mBlockCells(1),
+    mPrepared(kFALSE), mInnerBegin(0), mLastKey(-1), mLastBlock(-1) {}
+
+StDifferentialCube::~StDifferentialCube() {
+
+}
+
+void StDifferentialCube::AddAxis(std::string name, std::string title, Int_t nBins, Double_t low, Double_t high) {
+  AddAxis(name, title, axisDef(nBins, low, high));
+}
+
+void StDifferentialCube::AddAxis(std::string name, std::string title, const axisDef& binning) {
+  if (!mKeys.empty()) {
+    LOG_ERROR << "differential cube " << GetName() << ": can not add axis " << name
+              << " to a filled cube" << endm;
+    return;
+  }
+  mAxisNames.push_back(name);
+  mAxisTitles.push_back(title);
+  mNBins.push_back(binning.nBins);
+  mLow.push_back(binning.low);
+  mHigh.push_back(binning.high);
+  mEdgeBegin.push_back(binning.uniform() ? -1 : (Int_t) mEdges.size());
+  mEdges.insert(mEdges.end(), binning.edges.begin(), binning.edges.end());
+
+  mBlockCells = 1;
+  for (Int_t i = std::max(0, Dimension() - 3); i < Dimension(); ++i)
+    mBlockCells *= mNBins[i];
+  mPrepared = kFALSE;
+}
+
+Int_t StDifferentialCube::AxisIndex(const std::string& name) const {
+  for (Int_t i = 0; i < Dimension(); ++i) {
+    if (mAxisNames[i] == name)
+      return i;
+  }
+  return -1;
+}
+
+axisDef StDifferentialCube::Binning(Int_t i) const {
+  // cubes written before variable axes have no mEdgeBegin
+  if ((size_t) i >= mEdgeBegin.size() || mEdgeBegin[i] < 0)
+    return axisDef(mNBins[i], mLow[i], mHigh[i]);
+  std::vector<Double_t>::const_iterator begin = mEdges.begin() + mEdgeBegin[i];
+  return axisDef(std::vector<double>(begin, begin + mNBins[i] + 1));
+}
+
+Long64_t StDifferentialCube::OuterCells() const {
+  Long64_t cells = 1;
+  for (Int_t i = 0; i < Dimension() - 3; ++i)
+    cells *= mNBins[i];
+  return cells;
+}
+
+Long64_t StDifferentialCube::Bytes() const {
+  return mCounts.capacity() * sizeof(UInt_t) + mKeys.capacity() * sizeof(Long64_t) +
+         mIndex.size() * kIndexEntryBytes + mIndex.bucket_count() * sizeof(void*);
+}
+
+Long64_t StDifferentialCube::BlockBytes() const {
+  return mBlockCells * sizeof(UInt_t) + sizeof(Long64_t) + kIndexEntryBytes;
+}
+
+void StDifferentialCube::Prepare() {
+  // after reading a cube back, only the persistent members are set
+  mInnerBegin = std::max(0, Dimension() - 3);
+  mAxes.clear();
+  for (Int_t i = 0; i < Dimension(); ++i)
+    mAxes.push_back(Binning(i));
+  mIndex.clear();
+  mIndex.reserve(mKeys.size());
+  for (size_t i = 0; i < mKeys.size(); ++i)
+    mIndex[mKeys[i]] = i * mBlockCells;
+  mLastKey = -1;
+  mLastBlock = -1;
+  mPrepared = kTRUE;
+}
+
+Long64_t StDifferentialCube::FindBlock(Long64_t key, Bool_t bounded) {
+  std::unordered_map<Long64_t, Long64_t>::const_iterator it = mIndex.find(key);
+  Long64_t block;
+  if (it != mIndex.end()) {
+    block = it->second;
+  } else {
+    Bool_t limited = bounded && mMemoryLimit > 0;
+    Long64_t needed = mCounts.size() + mBlockCells;
+    Long64_t others = Bytes() - mCounts.capacity() * sizeof(UInt_t) + sizeof(Long64_t) + kIndexEntryBytes;
+    if (limited && others + needed * (Long64_t) sizeof(UInt_t) > mMemoryLimit) {
+      if (mDropped == 0)
+        LOG_WARN << "differential cube " << GetName() << ": memory limit of " << mMemoryLimit / (1024 * 1024)
+                 << " MB reached after " << mKeys.size() << " blocks - further blocks are dropped" << endm;
+      return -1;
+    }
+    // grow by half, but never past the limit
+    if (needed > (Long64_t) mCounts.capacity()) {
+      Long64_t target = std::max(needed, (Long64_t) (mCounts.capacity() + mCounts.capacity() / 2));
+      if (limited)
+        target = std::max(needed, std::min(target, (Long64_t) ((mMemoryLimit - others) / sizeof(UInt_t))));
+      mCounts.reserve(target);
+    }
+    block = mCounts.size();
+    mCounts.resize(needed, 0);
+    mKeys.push_back(key);
+    mIndex[key] = block;
+  }
+  mLastKey = key;
+  mLastBlock = block;
+  return block;
+}
+
+TH1* StDifferentialCube::Project(const char* name, const std::vector<std::string>& axes) const {
+  std::vector<Int_t> index;
+  for (size_t i = 0; i < axes.size(); ++i) {
+    index.push_back(AxisIndex(axes[i]));
+    if (index.back() < 0) {
+      LOG_ERROR << "differential cube " << GetName() << ": no axis " << axes[i] << endm;
+      return nullptr;
+    }
+  }
+  if (index.empty() || index.size() > 3) {
+    LOG_ERROR << "differential cube " << GetName() << ": can project onto 1 - 3 axes, not "
+              << index.size() << endm;
+    return nullptr;
+  }
+
+  std::string title = GetTitle();
+  std::vector<axisDef> binning;
+  for (size_t i = 0; i < index.size(); ++i) {
+    title += ";" + mAxisTitles[index[i]];
+    binning.push_back(Binning(index[i]));
+  }
+  TH1* hist = axisDef::NewHistogram(name, title.c_str(), binning);
+
+  // the bin of every axis, decoded from the block key & the cell in the block
+  Int_t inner = std::max(0, Dimension() - 3);
+  std::vector<Int_t> bins(Dimension(), 0);
+  Int_t projected[3] = {0, 0, 0};
+  Double_t total = 0;
+  for (size_t block = 0; block < mKeys.size(); ++block) {
+    Long64_t key = mKeys[block];
+    for (Int_t i = inner - 1; i >= 0; --i) {
+      bins[i] = key % mNBins[i];
+      key /= mNBins[i];
+    }
+    const UInt_t* counts = &mCounts[block * mBlockCells];
+    for (Long64_t cell = 0; cell < mBlockCells; ++cell) {
+      if (counts[cell] == 0)
+        continue;
+      Long64_t rest = cell;
+      for (Int_t i = Dimension() - 1; i >= inner; --i) {
+        bins[i] = rest % mNBins[i];
+        rest /= mNBins[i];
+      }
+      for (size_t i = 0; i < index.size(); ++i)
+        projected[i] = bins[index[i]] + 1;
+      hist->AddBinContent(hist->GetBin(projected[0], projected[1], projected[2]), counts[cell]);
+      total += counts[cell];
+    }
+  }
+
+  // unit weights: the errors are the square root of the counts
+  hist->SetEntries(total);
+  hist->Sumw2();
+  hist->ResetStats();
+  hist->SetEntries(total);
+  return hist;
+}
+
+Bool_t StDifferentialCube::SameBinning(const StDifferentialCube& other) const {
+  if (Dimension() != other.Dimension())
+    return kFALSE;
+  for (Int_t i = 0; i < Dimension(); ++i) {
+    if (Binning(i) != other.Binning(i))
+      return kFALSE;
+  }
+  return kTRUE;
+}
+
+Bool_t StDifferentialCube::Add(const StDifferentialCube& other) {
+  if (!SameBinning(other))
+    return kFALSE;
+  if (!mPrepared)
+    Prepare();
+  // a merge is never limited - it would silently lose counts
+  for (size_t i = 0; i < other.mKeys.size(); ++i) {
+    Long64_t block = FindBlock(other.mKeys[i], kFALSE);
+    const UInt_t* counts = &other.mCounts[i * mBlockCells];
+    for (Long64_t cell = 0; cell < mBlockCells; ++cell)
+      mCounts[block + cell] += counts[cell];
+  }
+  mEntries += other.mEntries;
+  mDropped += other.mDropped;
+  mOutOfRange += other.mOutOfRange;
+  return kTRUE;
+}
+
+Long64_t StDifferentialCube::Merge(TCollection* list) {
+  if (list == nullptr)
+    return mEntries;
+  TIter next(list);
+  while (TObject* obj = next()) {
+    if (!obj->InheritsFrom(StDifferentialCube::Class())) {
+      LOG_ERROR << "differential cube " << GetName() << ": can not merge " << obj->ClassName() << endm;
+      return -1;
+    }
+    if (!Add(*(const StDifferentialCube*) obj)) {
+      LOG_ERROR << "differential cube " << GetName() << ": can not merge different binning" << endm;
+      return -1;
+    }
+  }
+  return mEntries;
+}
+
+void StDifferentialCube::Reset() {
+  std::vector<Long64_t>().swap(mKeys);
+  std::vector<UInt_t>().swap(mCounts);
+  mIndex.clear();
+  mEntries = 0;
+  mDropped = 0;
+  mOutOfRange = 0;
+  mLastKey = -1;
+  mLastBlock = -1;
+}
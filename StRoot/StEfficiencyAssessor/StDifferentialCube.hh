@@ -0,0 +1,172 @@
+/* helper class for StEfficiencyAssessor output
+   an N-dimensional count histogram for the differential
+   efficiency study - e.g. (lumi, cent, vz, pt, eta, phi,
+   dca) - that only allocates the parts that get filled.
+   The last (up to) three axes form a dense block of
+   counters; a block is allocated the first time a fill
+   lands in its cell of the outer axes, and found through
+   a hash of the outer bin index. A cube binned like the
+   old per-(lumi, cent, vz, pt) TH3Fs holds only the
+   blocks of the cells the data reaches
+
+   the counters are capped at a memory limit - fills that
+   would need a block beyond it are dropped and counted
+   (Dropped()), so a job never outgrows its memory request.
+   The block index can overshoot the limit by a few kB.
+   Fills outside the axes (low <= x < high) are counted in
+   OutOfRange() and not stored: there are no under- or
+   overflow bins
+
+   written to the output as is - Project() sums the cube
+   onto up to three of its axes as a TH1D, TH2D or TH3D,
+   and Merge() adds cubes with the same binning, so hadd
+   merges them
+ */
+
+#ifndef STDIFFERENTIALCUBE__HH
+#define STDIFFERENTIALCUBE__HH
+
+#include "TNamed.h"
+
+#include "StAxisDef.hh"
+
+#include <string>
+#include <vector>
+#if !defined(__CINT__) && !defined(__CLING__)
+#include <unordered_map>
+#endif
+
+class TH1;
+class TCollection;
+
+class StDifferentialCube : public TNamed {
+
+public:
+
+  StDifferentialCube();
+  StDifferentialCube(const char* name, const char* title);
+  ~StDifferentialCube();
+
+  /* outermost first - the axes are fixed once the cube is
+     filled. title is used for projections
+   */
+  void AddAxis(std::string name, std::string title, const axisDef& binning);
+  void AddAxis(std::string name, std::string title, Int_t nBins, Double_t low, Double_t high);
+
+  Int_t Dimension() const                {return mNBins.size();}
+  const std::string& AxisName(Int_t i) const {return mAxisNames[i];}
+  Int_t AxisIndex(const std::string& name) const;
+  axisDef Binning(Int_t i) const;
+
+  /* counters the cube may allocate, in bytes - 0 (the
+     default) is unlimited
+   */
+  void SetMemoryLimit(Long64_t bytes) {mMemoryLimit = bytes;}
+  Long64_t MemoryLimit() const        {return mMemoryLimit;}
+
+  /* x holds one coordinate per axis, outermost first */
+  inline void Fill(const Double_t* x) {
+    if (!mPrepared)
+      Prepare();
+    Long64_t outer = 0;
+    for (Int_t i = 0; i < mInnerBegin; ++i) {
+      Int_t bin = Bin(i, x[i]);
+      if (bin < 0) {
+        mOutOfRange++;
+        return;
+      }
+      outer = outer * mNBins[i] + bin;
+    }
+    Long64_t inner = 0;
+    for (Int_t i = mInnerBegin; i < Dimension(); ++i) {
+      Int_t bin = Bin(i, x[i]);
+      if (bin < 0) {
+        mOutOfRange++;
+        return;
+      }
+      inner = inner * mNBins[i] + bin;
+    }
+    Long64_t block = outer == mLastKey ? mLastBlock : FindBlock(outer);
+    if (block < 0) {
+      mDropped++;
+      return;
+    }
+    mCounts[block + inner]++;
+    mEntries++;
+  }
+
+  /* sums the cube onto the named axes (1 - 3 of them) - owned
+     by the caller, and not attached to any directory. nullptr
+     if an axis is unknown
+   */
+  TH1* Project(const char* name, const std::vector<std::string>& axes) const;
+
+  /* adds the cubes in list to this one, for hadd &
+     TFileMerger. The binning has to be identical
+   */
+  Long64_t Merge(TCollection* list);
+
+  /* adds other, which has to have the same binning */
+  Bool_t Add(const StDifferentialCube& other);
+  Bool_t SameBinning(const StDifferentialCube& other) const;
+
+  /* drops every block & counter - the axes stay */
+  void Reset();
+
+  Long64_t Entries() const    {return mEntries;}
+  Long64_t Dropped() const    {return mDropped;}
+  Long64_t OutOfRange() const {return mOutOfRange;}
+  Long64_t Blocks() const     {return mKeys.size();}
+  Long64_t BlockCells() const {return mBlockCells;}
+  Long64_t OuterCells() const;
+
+  /* memory held by the counters & the block index */
+  Long64_t Bytes() const;
+
+private:
+
+  // -1 outside the axis, and for NaN
+  inline Int_t Bin(Int_t axis, Double_t x) const {
+    Int_t bin = mAxes[axis].bin(x);
+    return (UInt_t) bin < mAxes[axis].nBins ? bin : -1;
+  }
+
+  void Prepare();
+  Long64_t FindBlock(Long64_t key, Bool_t bounded = kTRUE);
+  Long64_t BlockBytes() const;
+
+  std::vector<std::string> mAxisNames;
+  std::vector<std::string> mAxisTitles;
+  std::vector<Int_t>       mNBins;
+  std::vector<Double_t>    mLow;
+  std::vector<Double_t>    mHigh;
+  // the edges of the variable axes, back to back - mEdgeBegin is an
+  // axis' first edge in mEdges, -1 for uniform bins
+  std::vector<Double_t>    mEdges;
+  std::vector<Int_t>       mEdgeBegin;
+
+  Long64_t mMemoryLimit;
+  Long64_t mEntries;
+  Long64_t mDropped;
+  Long64_t mOutOfRange;
+
+  // the outer bin index of every block, in allocation order, and the
+  // blocks' counters back to back
+  Long64_t              mBlockCells;
+  std::vector<Long64_t> mKeys;
+  std::vector<UInt_t>   mCounts;
+
+  // rebuilt from the axes & mKeys before the first fill or add
+  Bool_t mPrepared;                                   //!
+  Int_t mInnerBegin;                                  //!
+  std::vector<axisDef> mAxes;                         //!
+#if !defined(__CINT__) && !defined(__CLING__)
+  std::unordered_map<Long64_t, Long64_t> mIndex;      //!
+#endif
+  Long64_t mLastKey;                                  //!
+  Long64_t mLastBlock;                                //!
+
+  ClassDef(StDifferentialCube, 2)
+};
+
+#endif // STDIFFERENTIALCUBE__HH
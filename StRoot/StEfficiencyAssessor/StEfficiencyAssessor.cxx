@@ -1,9 +1,6 @@
 #include "StEfficiencyAssessor.hh"
 
 #include "St_base/StMessMgr.h"
-#include "StMiniMcEvent/StMiniMcPair.h"
-#include "StMiniMcEvent/StTinyMcTrack.h"
-#include "StMiniMcEvent/StContamPair.h"
 
 #include "StMuDSTMaker/COMMON/StMuTrack.h"
 
@@ -12,11 +9,89 @@
 
 #include "StRefMultCorr/CentralityMaker.h"
 
+#include "StEventIndex.hh"
+#include "StMiniMcReader.hh"
+#include "StMiniMcPrefetcher.hh"
+#include "StStageIn.hh"
+#include "StHistogramWriter.hh"
+#include "StHistogramRegistry.hh"
+#include "StCheckpoint.hh"
+#include "StFlatResultWriter.hh"
+#include "StEfficiencyTable.hh"
+
 #include <iostream>
+#include <sstream>
+#include <cctype>
+#include <chrono>
 
 ClassImp(StEfficiencyAssessor);
 
+namespace {
+    // the muDst arrays Make reads: MuEvent for the ids, refMult, grefmult,
+    // ZDC rate & triggers, PrimaryVertices behind primaryVertexPosition(),
+    // and PrimaryTracks for flag, nHitsFit, nHitsPoss, pt, eta, phi and
+    // dcaGlobal
+    const char* kMuDstArrays[] = {"MuEvent", "PrimaryVertices", "PrimaryTracks"};
+    const int kNMuDstArrays = sizeof(kMuDstArrays) / sizeof(kMuDstArrays[0]);
+
+    // wall time in seconds, for the checkpoint interval
+    double Now() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::string BaseName(std::string path) {
+        return path.substr(path.find_last_of('/') + 1);
+    }
+
+    typedef StHistogramRegistry Registry;
+}
+
 StEfficiencyAssessor::StEfficiencyAssessor(TChain* mcTree, std::string outputFile) {
+    p18ih_cent_def_ = nullptr;
+    p16id_cent_def_ = nullptr;
+    chain_ = nullptr;
+    out_ = nullptr;
+    out_path_ = outputFile;
+    histograms_ = new StHistogramRegistry();
+    histograms_->EnableFamily("differential", false);
+    reader_ = nullptr;
+    prefetcher_ = nullptr;
+    mc_event_ = nullptr;
+    mc_input_ = nullptr;
+    pair_chain_ = nullptr;
+    pair_by_file_ = false;
+    pair_skipped_ = false;
+    prune_mudst_ = true;
+    stage_ = nullptr;
+    stage_dir_ = "";
+    stage_lookahead_ = 2;
+    stage_max_bytes_ = 20000000000LL;
+    muDstMaker_ = nullptr;
+    index_ = nullptr;
+    mu_index_ = nullptr;
+    index_dir_ = "";
+    use_index_sidecars_ = true;
+    match_mode_ = kIndexMatch;
+    cache_size_ = 0;
+    read_ahead_ = true;
+    prefetch_depth_ = 0;
+    writer_ = nullptr;
+    out_compression_ = -1;
+    out_layout_ = kFlatLayout;
+    sparse_output_ = false;
+    flat_output_ = "";
+    efficiency_output_ = "";
+    efficiency_eta_ = false;
+    checkpoint_path_ = "";
+    checkpoint_events_ = 10000;
+    checkpoint_seconds_ = 600;
+    checkpoint_writer_ = nullptr;
+    resume_ = nullptr;
+    events_made_ = 0;
+    last_checkpoint_event_ = 0;
+    last_checkpoint_time_ = 0;
+    checkpoints_written_ = 0;
+
     if (!LoadTree(mcTree)) {
         LOG_ERROR << "load chain failed" << endm;
     }
@@ -33,11 +108,23 @@ StEfficiencyAssessor::StEfficiencyAssessor(TChain* mcTree, std::string outputFil
     minFitFrac_ = 0.52;
     maxDCA_ = 3.0;
 
-    out_ = new TFile(outputFile.c_str(), "RECREATE");
+    OpenOutput();
 }
 
 StEfficiencyAssessor::~StEfficiencyAssessor() {
-
+    delete stage_;
+    delete prefetcher_;
+    delete index_;
+    delete mu_index_;
+    delete reader_;
+    delete pair_chain_;
+    delete writer_;
+    delete checkpoint_writer_;
+    delete resume_;
+    delete histograms_;
+    delete out_;
+    // p16id_cent_def_ belongs to CentralityMaker
+    delete p18ih_cent_def_;
 }
 
 int StEfficiencyAssessor::Init() {
@@ -45,14 +132,30 @@ int StEfficiencyAssessor::Init() {
         return kStFatal;
     if (InitOutput() != kStOK)
         return kStFatal;
+    cuts_.ResetCounters();
+    if (!InitCheckpoint())
+        return kStFatal;
     return kStOK;
 }
 
+axisDef StEfficiencyAssessor::DefaultCentralityAxis() {
+    return axisDef(9, -0.5, 8.5);
+}
+
+axisDef StEfficiencyAssessor::DefaultPtAxis() {
+    std::vector<double> ptEdges;
+    for (int i = 0; i <= 20; ++i)
+        ptEdges.push_back(i / 10.0);
+    for (int i = 1; i <= 6; ++i)
+        ptEdges.push_back(2.0 + 0.5 * i);
+    return axisDef(ptEdges);
+}
+
 void StEfficiencyAssessor::SetDefaultAxes() {
     lumi_axis_ = axisDef(3, 0.0, 1e5);
-    cent_axis_ = axisDef(9, -0.5, 8.5);
+    cent_axis_ = DefaultCentralityAxis();
     vz_axis_ = axisDef(5, -30, 30);
-    pt_axis_   = axisDef(20, 0.0, 5.0);
+    pt_axis_   = DefaultPtAxis();
     eta_axis_  = axisDef(5, -1.0, 1.0);
     phi_axis_  = axisDef(6, -TMath::Pi(), TMath::Pi());
 }
@@ -73,6 +176,10 @@ void StEfficiencyAssessor::SetPtAxis(unsigned n, double low, double high) {
     pt_axis_ = axisDef(n, low, high);
 }
 
+void StEfficiencyAssessor::SetPtAxis(const std::vector<double>& edges) {
+    pt_axis_ = axisDef(edges);
+}
+
 void StEfficiencyAssessor::SetEtaAxis(unsigned n, double low, double high) {
     eta_axis_ = axisDef(n, low, high);
 }
@@ -92,28 +199,270 @@ bool StEfficiencyAssessor::LoadTree(TChain* chain) {
         return false;
     }
     chain_ = chain;
-    event_ = new StMiniMcEvent;
-    
-    chain_->SetBranchAddress("StMiniMcEvent", &event_);
-    chain_->GetEntry(0);
+
+    mc_header_reads_ = 0;
+    mc_track_reads_ = 0;
+    matched_events_ = 0;
+    orphan_mu_events_ = 0;
+    orphan_mc_events_ = 0;
+    unsorted_mu_events_ = 0;
+    pair_mu_file_ = "";
+    pair_skipped_ = false;
+    pair_files_.clear();
+
+    if (!OpenMcInput(chain_))
+        return false;
+    // the reader of the previous pair chain is gone with OpenMcInput
+    delete pair_chain_;
+    pair_chain_ = nullptr;
+
+    // the index, cache & prefetcher are set up in Init, once their
+    // options are known - or here, for a chain loaded after Init
+    if (muDstMaker_ != nullptr) {
+        if (pair_by_file_)
+            return BuildPairs();
+        return ConfigureMcInput();
+    }
+    return true;
+}
+
+void StEfficiencyAssessor::UnloadTree() {
+    delete prefetcher_;
+    prefetcher_ = nullptr;
+    delete index_;
+    index_ = nullptr;
+    delete mu_index_;
+    mu_index_ = nullptr;
+    delete reader_;
+    reader_ = nullptr;
+    delete pair_chain_;
+    pair_chain_ = nullptr;
+    delete stage_;
+    stage_ = nullptr;
+    chain_ = nullptr;
+    mc_input_ = nullptr;
+    mc_event_ = nullptr;
+    pair_mu_file_ = "";
+    pair_skipped_ = false;
+    pair_files_.clear();
+
+    // the muDst maker belongs to the chain of the job
+    muDstMaker_ = nullptr;
+    muDst_ = nullptr;
+    muInputEvent_ = nullptr;
+}
+
+void StEfficiencyAssessor::SetOutputFile(std::string outputFile) {
+    if (out_ != nullptr) {
+        out_->Close();
+        delete out_;
+        out_ = nullptr;
+    }
+    out_path_ = outputFile;
+}
+
+bool StEfficiencyAssessor::OpenOutput() {
+    out_ = new TFile(out_path_.c_str(), "RECREATE");
+    if (out_->IsZombie()) {
+        LOG_ERROR << "could not create output file " << out_path_ << endm;
+        delete out_;
+        out_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool StEfficiencyAssessor::OpenMcInput(TChain* chain) {
+    // only the branches Make uses are read, into flat arrays. If the new
+    // input can not be read, the previous one stays open
+    StMiniMcReader* reader = new StMiniMcReader();
+    if (!reader->Open(chain) || !reader->Read(0)) {
+        LOG_ERROR << "could not read StMiniMcTree" << endm;
+        delete reader;
+        return false;
+    }
+
+    // the index and the prefetcher belong to the previous input
+    delete prefetcher_;
+    prefetcher_ = nullptr;
+    delete index_;
+    index_ = nullptr;
+    delete reader_;
+    reader_ = reader;
+    mc_input_ = chain;
+    mc_event_ = &reader_->Event();
+    mc_prefetched_ = false;
+    current_ = 0;
+    current_matched_ = false;
+    mc_exhausted_ = false;
+    last_mu_key_ = 0;
+    return true;
+}
+
+bool StEfficiencyAssessor::ConfigureMcInput() {
+    // merge-join walks the chain in order and needs no index
+    if (match_mode_ == kIndexMatch && !BuildIndex())
+        return false;
+    reader_->SetReadAhead(read_ahead_);
+    reader_->ConfigureCache(cache_size_);
+    if (prefetch_depth_ > 0 && PrefetchInOrder()) {
+        delete prefetcher_;
+        prefetcher_ = new StMiniMcPrefetcher(prefetch_depth_);
+        if (!prefetcher_->Start(mc_input_, 0, cache_size_)) {
+            LOG_WARN << "miniMC prefetch could not start: reading on the main thread" << endm;
+            delete prefetcher_;
+            prefetcher_ = nullptr;
+        }
+    }
+    return true;
+}
+
+bool StEfficiencyAssessor::BuildPairs() {
+    pair_files_.clear();
+    TObjArray* files = chain_->GetListOfFiles();
+    for (int i = 0; i < files->GetEntriesFast(); ++i) {
+        std::string file = files->At(i)->GetTitle();
+        std::string key = PairKey(file);
+        if (pair_files_.count(key)) {
+            LOG_WARN << "file pairing: " << file << " has the same run & sequence as "
+                     << pair_files_[key] << " - it is not used" << endm;
+            continue;
+        }
+        pair_files_[key] = file;
+    }
+    LOG_INFO << "file pairing: " << pair_files_.size() << " miniMC files" << endm;
+    return true;
+}
+
+std::string StEfficiencyAssessor::PairKey(std::string path) {
+    // STAR file names carry the run number & file sequence, as in
+    // st_physics_adc_15107008_raw_1000012.MuDst.root - files without
+    // them are paired by their name up to the first '.'
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    size_t raw = name.find("_raw_");
+    if (raw != std::string::npos) {
+        size_t begin = raw;
+        while (begin > 0 && isdigit(name[begin - 1]))
+            --begin;
+        size_t end = raw + 5;
+        while (end < name.size() && isdigit(name[end]))
+            ++end;
+        if (begin < raw && end > raw + 5)
+            return name.substr(begin, end - begin);
+    }
+    return name.substr(0, name.find('.'));
+}
+
+bool StEfficiencyAssessor::SwitchPair() {
+    std::string muFile = muDstMaker_->GetFile();
+    if (muFile == pair_mu_file_) {
+        if (!pair_skipped_)
+            return reader_ != nullptr;
+        orphan_mu_events_++;
+        return false;
+    }
+    pair_mu_file_ = muFile;
+    pair_skipped_ = false;
+
+    // the rest of the previous miniMC file will never be reached
+    if (match_mode_ == kMergeJoin && mc_input_ != chain_)
+        orphan_mc_events_ += McRemaining();
+
+    std::map<std::string, std::string>::iterator partner = pair_files_.find(PairKey(muFile));
+    if (partner == pair_files_.end()) {
+        // the full chain is never reopened: merge-join would rewind it,
+        // and an index match would index & open every file again
+        LOG_WARN << "file pairing: no miniMC file for " << muFile << " - its events are counted as unmatched" << endm;
+        return SkipPair();
+    }
+
+    // only the partner file is open while its muDst is processed
+    TChain* pair = new TChain(chain_->GetName());
+    std::string mcFile = partner->second;
+    if (stage_ != nullptr)
+        mcFile = stage_->Resolve(mcFile);
+    pair->Add(mcFile.c_str());
+    if (!OpenMcInput(pair)) {
+        // the previous partner stays open, but none of its events can
+        // match - the muDst file is skipped
+        LOG_ERROR << "file pairing: could not read " << mcFile << " - the events of " << muFile
+                  << " are counted as unmatched" << endm;
+        delete pair;
+        return SkipPair();
+    }
+    delete pair_chain_;
+    pair_chain_ = pair;
+    LOG_DEBUG << "file pairing: " << muFile << " -> " << partner->second << endm;
+    return ConfigureMcInput();
+}
+
+bool StEfficiencyAssessor::SkipPair() {
+    // the previous input stays open, but none of its events can match -
+    // and whatever was left of it is already counted
+    mc_exhausted_ = true;
+    pair_skipped_ = true;
+    orphan_mu_events_++;
+    return false;
+}
+
+bool StEfficiencyAssessor::PrefetchInOrder() const {
+    return match_mode_ != kIndexMatch || pair_by_file_;
+}
+
+Long64_t StEfficiencyAssessor::McRemaining() {
+    if (mc_input_ == nullptr || mc_exhausted_)
+        return 0;
+    return mc_input_->GetEntries() - current_ - (current_matched_ ? 1 : 0);
+}
+
+bool StEfficiencyAssessor::BuildIndex() {
+    // index the chain by (runId, eventId) so LoadEvent never has to scan it
+    delete index_;
+    index_ = new StEventIndex();
+    index_->SetSidecarDirectory(index_dir_);
+    index_->UseSidecars(use_index_sidecars_);
+    if (!index_->Build(mc_input_)) {
+        LOG_ERROR << "could not build miniMC event index" << endm;
+        delete index_;
+        index_ = nullptr;
+        return false;
+    }
     return true;
 }
 
 bool StEfficiencyAssessor::CheckAxes() {
-    return lumi_axis_.valid() && cent_axis_.valid() && pt_axis_.valid()
-        && eta_axis_.valid() && phi_axis_.valid();
+    return lumi_axis_.valid() && cent_axis_.valid() && vz_axis_.valid()
+        && pt_axis_.valid() && eta_axis_.valid() && phi_axis_.valid();
 }
 
 Int_t StEfficiencyAssessor::Make() {
-    if (event_ == nullptr) {
+    if (reader_ == nullptr) {
         LOG_ERROR << "StMiniMcEvent Branch not loaded properly: exiting run loop" << endm;
         return kStFatal;
     }
-    // load the matching miniMC event
+    if (stage_ != nullptr)
+        stage_->Update();
+    // a resumed job skips the events before its checkpoint
+    if (resume_ != nullptr && FastForward())
+        return kStOK;
+    if (checkpoint_writer_ != nullptr &&
+            (events_made_ - last_checkpoint_event_ >= checkpoint_events_ ||
+             Now() - last_checkpoint_time_ >= checkpoint_seconds_))
+        WriteCheckpoint();
+    events_made_++;
+    // match the miniMC event - only its header (ids, vertex z) is read here
     if (LoadEvent() == false) {
+        // in merge-join mode muDst events without a partner are expected, and
+        // counted - as are the events of a muDst file whose partner is unreadable
+        if ((match_mode_ == kMergeJoin || pair_skipped_) && muInputEvent_ != nullptr)
+            return kStOK;
+        // in miniMC-driven mode the miniMC chain decides when the job ends
+        if (match_mode_ == kMiniMcDriven && mc_exhausted_)
+            return kStEOF;
         LOG_ERROR << "Could not find miniMC event matching muDST event" << endm;
         return kStErr;
     }
+    mc_header_reads_++;
 
     // check event cuts 
     if (!cuts_.AcceptEvent(muInputEvent_))
@@ -121,7 +470,7 @@ Int_t StEfficiencyAssessor::Make() {
 
     int centrality = 0;
     if (p18ih_cent_def_ != nullptr) {
-        p18ih_cent_def_->setEvent(muInputEvent_->runId(), muInputEvent_->refMult(), muInputEvent_->runInfo().zdcCoincidenceRate(), event_->vertexZ());
+        p18ih_cent_def_->setEvent(muInputEvent_->runId(), muInputEvent_->refMult(), muInputEvent_->runInfo().zdcCoincidenceRate(), mc_event_->vertexZ);
         centrality = p18ih_cent_def_->centrality9();
     }
     else if (p16id_cent_def_ != nullptr) {
@@ -138,71 +487,88 @@ Int_t StEfficiencyAssessor::Make() {
     if (fabs(muInputEvent_->primaryVertexPosition().z()) > 30)
         return kStOK;
     
-    vz_->Fill(muInputEvent_->primaryVertexPosition().z());
-    refmult_->Fill(muInputEvent_->refMult());
-    grefmult_->Fill(muInputEvent_->grefmult());
-    centrality_->Fill(centrality);
+    // every histogram of a stage is filled from values - see DefineHistograms
+    double values[Registry::kNVariables] = {0};
+    values[Registry::kCentrality] = centrality;
+    values[Registry::kLumi] = muInputEvent_->runInfo().zdcCoincidenceRate();
+    values[Registry::kVz] = muInputEvent_->primaryVertexPosition().z();
+    values[Registry::kRefMult] = muInputEvent_->refMult();
+    values[Registry::kGRefMult] = muInputEvent_->grefmult();
+    histograms_->Fill(Registry::kEvent, values);
+
+    // the track arrays are decoded only for events passing the cuts
+    if (!ReadMcTracks()) {
+        LOG_ERROR << "could not read miniMC tracks" << endm;
+        return kStErr;
+    }
+    mc_track_reads_++;
     
-    TClonesArray* mc_array = event_->tracks(MC);
-    TIter next_mc(mc_array);
-    StTinyMcTrack* track = nullptr;
+    // the track loops of disabled families are skipped
+    bool countTracks = histograms_->Active(Registry::kTrackCounts);
+    const StMiniMcFlatEvent& event = *mc_event_;
+    bool fillMc = countTracks || histograms_->Active(Registry::kMcTrack);
     unsigned count_mc = 0;
-    while ((track = (StTinyMcTrack*) next_mc())) {
-        if (geant_ids_.size() && geant_ids_.find(track->geantId()) == geant_ids_.end())
+    for (int i = 0; fillMc && i < event.nMc; ++i) {
+        if (geant_ids_.size() && geant_ids_.find(event.mcGeantId[i]) == geant_ids_.end())
             continue;
 
-        if (track->parentGeantId() != 0)
+        if (event.mcParentGeantId[i] != 0)
             continue;
 
         count_mc++;
-        mc_tracks_->Fill(centrality, track->ptMc());
-        mc_eta_->Fill(centrality, track->ptMc(), track->etaMc());
-        mc_phi_->Fill(centrality, track->ptMc(), track->phiMc());
+        values[Registry::kPt] = event.mcPt[i];
+        values[Registry::kEta] = event.mcEta[i];
+        values[Registry::kPhi] = event.mcPhi[i];
+        histograms_->Fill(Registry::kMcTrack, values);
     }
 
 
-    TClonesArray* match_array = event_->tracks(MATCHED);
-    TIter next_match(match_array);
-    StMiniMcPair* pair = nullptr;
+    bool fillReco = countTracks || histograms_->Active(Registry::kRecoTrack) ||
+        histograms_->Active(Registry::kRecoTrackScale) || histograms_->Active(Registry::kRecoTrackCut);
     unsigned count_pair = 0;
-    while ((pair = (StMiniMcPair*) next_match())) {
-        if (geant_ids_.size() && geant_ids_.find(pair->geantId()) == geant_ids_.end())
+    for (int i = 0; fillReco && i < event.nMatched; ++i) {
+        if (geant_ids_.size() && geant_ids_.find(event.geantId[i]) == geant_ids_.end())
             continue;
       
-        if (pair->parentGeantId() != 0)
+        if (event.parentGeantId[i] != 0)
             continue;
+
+        Float_t ptPr = event.ptPr[i];
+        Float_t etaPr = event.etaPr[i];
+        Float_t phiPr = event.phiPr[i];
+        Float_t dcaGl = event.dcaGl[i];
+        int fitPts = event.fitPts[i];
+        int nPossiblePts = event.nPossiblePts[i];
     
-        reco_nhit_->Fill(centrality, pair->ptPr(), pair->fitPts()+1);
-        reco_dca_->Fill(centrality, pair->ptPr(), pair->dcaGl());
-        reco_eta_->Fill(centrality, pair->ptPr(), pair->etaPr());
-        reco_phi_->Fill(centrality, pair->ptPr(), pair->phiPr());
-        reco_nhitposs_->Fill(centrality, pair->ptPr(), pair->nPossiblePts()+1);
-        reco_fitfrac_->Fill(centrality, pair->ptPr(), (double)(pair->fitPts()+1)/(pair->nPossiblePts()+1));
-
-        if (fabs(pair->etaPr()) > 1.0)
+        values[Registry::kPt] = ptPr;
+        values[Registry::kNhit] = fitPts+1;
+        values[Registry::kDca] = dcaGl;
+        values[Registry::kEta] = etaPr;
+        values[Registry::kPhi] = phiPr;
+        values[Registry::kNhitPoss] = nPossiblePts+1;
+        values[Registry::kFitFrac] = (double)(fitPts+1)/(nPossiblePts+1);
+        histograms_->Fill(Registry::kRecoTrack, values);
+
+        if (fabs(etaPr) > 1.0)
             continue;
 
-        if ((double) (pair->fitPts()+1) / (pair->nPossiblePts()+1) < minFitFrac_)
+        if (values[Registry::kFitFrac] < minFitFrac_)
             continue;
       
-        reco_dca_scale_->Fill(centrality, pair->ptPr(), pair->dcaGl());
+        histograms_->Fill(Registry::kRecoTrackScale, values);
       
-        if (pair->dcaGl() > maxDCA_ || pair->fitPts() < minFit_)
+        if (dcaGl > maxDCA_ || fitPts < minFit_)
           continue;
       
         count_pair++;
-        reco_tracks_->Fill(centrality, pair->ptPr());
-        reco_cut_nhit_->Fill(centrality, pair->ptPr(), pair->fitPts()+1);
-        reco_cut_dca_->Fill(centrality, pair->ptPr(), pair->dcaGl());
-        reco_cut_eta_->Fill(centrality, pair->ptPr(), pair->etaPr());
-        reco_cut_phi_->Fill(centrality, pair->ptPr(), pair->phiPr());
-        reco_cut_nhitposs_->Fill(centrality, pair->ptPr(), pair->nPossiblePts()+1);
-        reco_cut_fitfrac_->Fill(centrality, pair->ptPr(), (double)(pair->fitPts()+1)/(pair->nPossiblePts()+1));
-        dca_reco_cut_ext_->Fill(centrality, pair->ptPr(), pair->dcaGl());
-    }
-    mc_reco_tracks_->Fill(centrality, count_mc, count_pair);
-
-    for (int i = 0; i < muDst_->primaryTracks()->GetEntries(); ++i) {
+        histograms_->Fill(Registry::kRecoTrackCut, values);
+    }
+    values[Registry::kMcTracks] = count_mc;
+    values[Registry::kRecoTracks] = count_pair;
+    histograms_->Fill(Registry::kTrackCounts, values);
+
+    bool fillData = histograms_->Active(Registry::kDataTrackScale) || histograms_->Active(Registry::kDataTrackCut);
+    for (int i = 0; fillData && i < muDst_->primaryTracks()->GetEntries(); ++i) {
         StMuTrack* muTrack = (StMuTrack*) muDst_->primaryTracks(i);
         if (muTrack->flag() < 0)
             continue;
@@ -213,18 +579,19 @@ Int_t StEfficiencyAssessor::Make() {
         if (fabs(muTrack->eta()) > 1.0)
             continue;
       
-        data_dca_scale_->Fill(centrality, muTrack->pt(), muTrack->dcaGlobal().mag());
+        values[Registry::kPt] = muTrack->pt();
+        values[Registry::kDca] = muTrack->dcaGlobal().mag();
+        histograms_->Fill(Registry::kDataTrackScale, values);
       
-        if (muTrack->dcaGlobal().mag() > maxDCA_)
+        if (values[Registry::kDca] > maxDCA_)
           continue;
         
-        data_nhit_->Fill(centrality, muTrack->pt(), muTrack->nHitsFit());
-        data_dca_->Fill(centrality, muTrack->pt(), muTrack->dcaGlobal().mag());
-        data_eta_->Fill(centrality, muTrack->pt(), muTrack->eta());
-        data_phi_->Fill(centrality, muTrack->pt(), muTrack->phi());
-        data_nhitposs_->Fill(centrality, muTrack->pt(), muTrack->nHitsPoss(kTpcId)+1);
-        data_fitfrac_->Fill(centrality, muTrack->pt(), (double)(muTrack->nHitsFit())/(muTrack->nHitsPoss(kTpcId)+1));
-        dca_data_cut_ext_->Fill(centrality, muTrack->pt(), muTrack->dcaGlobal().mag());
+        values[Registry::kNhit] = muTrack->nHitsFit();
+        values[Registry::kEta] = muTrack->eta();
+        values[Registry::kPhi] = muTrack->phi();
+        values[Registry::kNhitPoss] = muTrack->nHitsPoss(kTpcId)+1;
+        values[Registry::kFitFrac] = (double)(muTrack->nHitsFit())/(muTrack->nHitsPoss(kTpcId)+1);
+        histograms_->Fill(Registry::kDataTrackCut, values);
     }
 
 
@@ -233,50 +600,68 @@ Int_t StEfficiencyAssessor::Make() {
 
 
 Int_t StEfficiencyAssessor::Finish() {
-    if (out_ == nullptr) {
-        out_ = new TFile("stefficiencyassessor.root", "RECREATE");
-    }
-
-    out_->cd();
-
-    vz_->Write();
-    refmult_->Write();
-    grefmult_->Write();
-    centrality_->Write();
-    mc_reco_tracks_->Write();
-    mc_tracks_->Write();
-    reco_tracks_->Write();
-
-    mc_eta_->Write();
-    mc_phi_->Write();
-
-    reco_nhit_->Write();
-    reco_dca_->Write();
-    reco_nhitposs_->Write();
-    reco_eta_->Write();
-    reco_phi_->Write();
-    reco_fitfrac_->Write();
-    reco_dca_scale_->Write();
-  
-    reco_cut_nhit_->Write();
-    reco_cut_dca_->Write();
-    reco_cut_nhitposs_->Write();
-    reco_cut_eta_->Write();
-    reco_cut_phi_->Write();
-    reco_cut_fitfrac_->Write();
-
-    data_nhit_->Write();
-    data_dca_->Write();
-    data_nhitposs_->Write();
-    data_eta_->Write();
-    data_phi_->Write();
-    data_fitfrac_->Write();
-    data_dca_scale_->Write();
-
-    dca_reco_cut_ext_->Write();
-    dca_data_cut_ext_->Write();
+    if (out_ == nullptr && !OpenOutput())
+        return kStErr;
+
+    if (reader_ != nullptr)
+        reader_->PrintCacheStats();
+    if (stage_ != nullptr)
+        stage_->Print();
+    LOG_INFO << "miniMC events matched: " << mc_header_reads_ << ", track arrays decoded for "
+             << mc_track_reads_ << " passing the event cuts" << endm;
+    if (prefetcher_ != nullptr) {
+        LOG_INFO << "miniMC prefetch: " << prefetcher_->Hits() << " events taken from the ring ("
+                 << prefetcher_->Waits() << " waited for the decoder), " << prefetcher_->Misses()
+                 << " read on the main thread" << endm;
+        prefetcher_->Stop();
+    }
+
+    if (match_mode_ == kMiniMcDriven) {
+        Long64_t muEntries = mu_index_ != nullptr ? mu_index_->Entries() : 0;
+        LOG_INFO << "miniMC-driven: matched events: " << matched_events_ << endm;
+        LOG_INFO << "miniMC-driven: miniMC events without muDst partner: " << orphan_mc_events_ << endm;
+        LOG_INFO << "miniMC-driven: muDst events never read: " << muEntries - matched_events_
+                 << " of " << muEntries << endm;
+    }
+
+    if (match_mode_ == kMergeJoin) {
+        // whatever is left in the miniMC stream was never reached
+        Long64_t remaining = McRemaining();
+        LOG_INFO << "merge-join: matched events: " << matched_events_ << endm;
+        LOG_INFO << "merge-join: muDst events without miniMC partner: " << orphan_mu_events_ << endm;
+        LOG_INFO << "merge-join: miniMC events without muDst partner: " << orphan_mc_events_ + remaining << endm;
+        if (unsorted_mu_events_ > 0) {
+            LOG_WARN << "merge-join: " << unsorted_mu_events_ << " muDst events out of (runId, eventId) order - "
+                     << "their miniMC partners may have been dropped" << endm;
+        }
+    }
+    else if (pair_by_file_ && orphan_mu_events_ > 0) {
+        LOG_WARN << "file pairing: " << orphan_mu_events_ << " muDst events skipped, without a readable miniMC file" << endm;
+    }
+
+    // the writer logs the size & time of the write
+    histograms_->Flush();
+    bool written = writer_ != nullptr && writer_->Write(out_) >= 0;
+    if (!written)
+        LOG_ERROR << "could not write all histograms to " << out_->GetName() << endm;
+    if (!flat_output_.empty() && !WriteFlatOutput())
+        written = false;
+    if (!efficiency_output_.empty() && !WriteEfficiencyTable())
+        written = false;
+    if (histograms_->Cubes() > 0 && !WriteDifferentialOutput())
+        written = false;
+
+    // the output is complete - the checkpoint is only kept if it is not
+    if (!checkpoint_path_.empty()) {
+        LOG_INFO << "checkpoint: " << checkpoints_written_ << " checkpoints written" << endm;
+        if (written)
+            StCheckpoint::Remove(checkpoint_path_);
+    }
 
+    // the histograms are not owned by the file, and stay for the next job
     out_->Close();
+    delete out_;
+    out_ = nullptr;
     return kStOk;
 }
 
@@ -287,118 +672,638 @@ int StEfficiencyAssessor::InitInput() {
         LOG_ERROR << "No muDstMaker found in chain: StEfficiencyAssessor init failed" << endm;
         return kStFatal;
     }
+    if (prune_mudst_)
+        PruneMuDstArrays();
+    // the centrality definitions are kept from one Init to the next, so
+    // jobs of a worker set them up (and read the weights) only once
     if (TString(muDstMaker_->GetFile()).Contains("SL17d") ||
         TString(muDstMaker_->GetFile()).Contains("SL18f") ||
         TString(muDstMaker_->GetFile()).Contains("SL18h")) {
-        p18ih_cent_def_ = new CentralityDef();
+        if (p18ih_cent_def_ == nullptr)
+            p18ih_cent_def_ = new CentralityDef();
         p16id_cent_def_ = nullptr;
     }
     else if (TString(muDstMaker_->GetFile()).Contains("SL16d")) {
-        p16id_cent_def_ = CentralityMaker::instance()->getgRefMultCorr_P16id();
-        p16id_cent_def_->setVzForWeight(6, -6.0, 6.0);
-        p16id_cent_def_->readScaleForWeight("StRoot/StRefMultCorr/macros/weight_grefmult_vpd30_vpd5_Run14_P16id.txt");
+        if (p16id_cent_def_ == nullptr) {
+            p16id_cent_def_ = CentralityMaker::instance()->getgRefMultCorr_P16id();
+            p16id_cent_def_->setVzForWeight(6, -6.0, 6.0);
+            p16id_cent_def_->readScaleForWeight("StRoot/StRefMultCorr/macros/weight_grefmult_vpd30_vpd5_Run14_P16id.txt");
+        }
+        delete p18ih_cent_def_;
         p18ih_cent_def_ = nullptr;
     }
     else {
         LOG_ERROR << "Library could not be discovered: exiting" << endm;
         return kStFatal;
     }   
+    if (reader_ == nullptr)
+        return kStFatal;
+    // the assessor drives the muDst reads itself
+    if (match_mode_ == kMiniMcDriven) {
+        if (pair_by_file_) {
+            LOG_WARN << "file pairing follows the muDst stream: not used in miniMC-driven mode" << endm;
+            pair_by_file_ = false;
+        }
+        if (!BuildMuIndex())
+            return kStFatal;
+        muDstMaker_->SetActive(kFALSE);
+        LOG_INFO << "miniMC-driven mode: StMuDstMaker switched off, muDst events read by index" << endm;
+    }
+    // index hits land anywhere in the chain, so a decoder running ahead
+    // would mostly decode entries that are never asked for
+    if (prefetch_depth_ > 0 && !PrefetchInOrder()) {
+        LOG_WARN << "miniMC prefetch needs in-order reads: not used in index-match mode without file pairing" << endm;
+        prefetch_depth_ = 0;
+    }
+    // paired files are opened one at a time, as their muDst comes up
+    if (pair_by_file_) {
+        if (!BuildPairs())
+            return kStFatal;
+    }
+    else if (!ConfigureMcInput()) {
+        return kStFatal;
+    }
+    if (!stage_dir_.empty())
+        StartStageIn();
     return kStOK;
 }
 
+void StEfficiencyAssessor::StartStageIn() {
+    delete stage_;
+    stage_ = new StStageIn(stage_dir_, stage_lookahead_, stage_max_bytes_);
+    // only chains read strictly in order are staged: in miniMC-driven
+    // mode the muDst chain is read by index, and in index-match mode the
+    // miniMC chain is read wherever its events are
+    TChain* muChain = muDstMaker_->chain();
+    if (muChain != nullptr && match_mode_ != kMiniMcDriven)
+        stage_->AddChain(muChain);
+
+    // paired miniMC files follow the muDst chain file by file. The
+    // prefetch thread reads its own copy of the chain, so the miniMC
+    // chain is only staged when it is read on this thread
+    if (pair_by_file_ && muChain != nullptr) {
+        std::vector<std::string> partners;
+        TObjArray* files = muChain->GetListOfFiles();
+        for (int i = 0; i < files->GetEntriesFast(); ++i) {
+            std::map<std::string, std::string>::iterator partner = pair_files_.find(PairKey(files->At(i)->GetTitle()));
+            partners.push_back(partner == pair_files_.end() ? "" : partner->second);
+        }
+        stage_->AddFiles(partners, muChain);
+    }
+    else if (prefetcher_ == nullptr && match_mode_ != kIndexMatch) {
+        stage_->AddChain(chain_);
+    }
+    LOG_INFO << "stage-in: staging " << stage_lookahead_ << " files ahead to " << stage_dir_ << endm;
+}
+
+std::vector<std::string> StEfficiencyAssessor::MuDstArrays() const {
+    std::vector<std::string> arrays(kMuDstArrays, kMuDstArrays + kNMuDstArrays);
+    arrays.insert(arrays.end(), extra_mudst_arrays_.begin(), extra_mudst_arrays_.end());
+    return arrays;
+}
+
+void StEfficiencyAssessor::PruneMuDstArrays() {
+    std::vector<std::string> arrays = MuDstArrays();
+    muDstMaker_->SetStatus("*", 0);
+    for (unsigned i = 0; i < arrays.size(); ++i)
+        muDstMaker_->SetStatus(arrays[i].c_str(), 1);
+
+    // log what the chain will actually read
+    TChain* muChain = muDstMaker_->chain();
+    if (muChain == nullptr || muChain->GetListOfBranches() == nullptr)
+        return;
+    std::string active;
+    int nDisabled = 0;
+    TObjArray* branches = muChain->GetListOfBranches();
+    for (int i = 0; i < branches->GetEntriesFast(); ++i) {
+        const char* name = branches->At(i)->GetName();
+        if (muChain->GetBranchStatus(name))
+            active += std::string(active.empty() ? "" : ", ") + name;
+        else
+            nDisabled++;
+    }
+    LOG_INFO << "muDst pruning: reading " << active << endm;
+    LOG_INFO << "muDst pruning: " << nDisabled << " of " << branches->GetEntriesFast() << " branches switched off" << endm;
+}
+
 int StEfficiencyAssessor::InitOutput() {
     if (!CheckAxes()) {
         LOG_ERROR << "axes not valid: could not initialize histograms";
         return kStFatal;
     }
     
-    mc_eta_ = new TH3D("mceta", ";cent;pt;#eta", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, -1, 1);
-    mc_phi_ = new TH3D("mcphi", ";cent;pt;#phi", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, -TMath::Pi(), TMath::Pi());
-
-    reco_nhit_ = new TH3D("reconhit", ";cent;pt;nhit", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 50);
-    reco_dca_ = new TH3D("recodca", ";cent;pt;DCA[cm]", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 3.0);
-    reco_nhitposs_ = new TH3D("reconhitposs", ";cent;pt;nhitposs", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 50);
-    reco_eta_ = new TH3D("recoeta", ";cent;pt;#eta", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, -1, 1);
-    reco_phi_ = new TH3D("recophi", ";cent;pt;#phi", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, -TMath::Pi(), TMath::Pi());
-    reco_fitfrac_ = new TH3D("recofitfrac", ";cent;pt;fitfrac", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 1);
-  
-    reco_dca_scale_ = new TH3D("recodcascale", ";cent;pt;DCA[cm]", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 3.0);
-  
-    reco_cut_nhit_ = new TH3D("reconhitcut", ";cent;pt;nhit", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 50);
-    reco_cut_dca_ = new TH3D("recodcacut", ";cent;pt;DCA[cm]", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 3.0);
-    reco_cut_nhitposs_ = new TH3D("reconhitposscut", ";cent;pt;nhitposs", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 50);
-    reco_cut_eta_ = new TH3D("recoetacut", ";cent;pt;#eta", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, -1, 1);
-    reco_cut_phi_ = new TH3D("recophicut", ";cent;pt;#phi", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, -TMath::Pi(), TMath::Pi());
-    reco_cut_fitfrac_ = new TH3D("recocutfitfrac", ";cent;pt;fitfrac", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 1);
-    
-    data_nhit_ = new TH3D("datanhit", ";cent;pt;nhit", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 50);
-    data_dca_ = new TH3D("datadca", ";cent;pt;DCA[cm]", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 3.0);
-    data_nhitposs_ = new TH3D("datanhitposs", ";cent;pt;nhitposs", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 50);
-    data_eta_ = new TH3D("dataeta", ";cent;pt;#eta", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, -1, 1);
-    data_phi_ = new TH3D("dataphi", ";cent;pt;#phi", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, -TMath::Pi(), TMath::Pi());
-    data_fitfrac_ = new TH3D("datafitfrac", ";cent;pt;fitfrac", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 1);
-  
-    data_dca_scale_ = new TH3D("datadcascale", ";cent;pt;DCA[cm]", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high, 50, 0, 3.0);
-  
-    vz_ = new TH1D("vz", ";v_{z}[cm]", 60, -30, 30);
-    refmult_ = new TH1D("refmult", ";refmult", 800, 0, 800);
-    grefmult_ = new TH1D("grefmult", ";grefmult", 800, 0, 800);
-    centrality_ = new TH1D("centrality", ";centrality", cent_axis_.nBins, cent_axis_.low, cent_axis_.high);
-
-    mc_reco_tracks_ = new TH3D("mcrecotracks", ";cent;mc tracks;reco tracks", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, 50, 0, 50, 50, 0, 50);
-
-    mc_tracks_ = new TH2D("mctracks", ";cent;pt", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high);
-    reco_tracks_ = new TH2D("recotracks", ";cent;pt", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, pt_axis_.nBins, pt_axis_.low, pt_axis_.high);
-
-    dca_reco_cut_ext_ = new TH3D("recocutdcaext", ";cent;pt;DCA[cm]", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, 100, pt_axis_.low, pt_axis_.high, 50, 0, 3.0);
-    dca_data_cut_ext_ = new TH3D("datadcaext", ";cent;pt;DCA[cm]", cent_axis_.nBins, cent_axis_.low, cent_axis_.high, 100, pt_axis_.low, pt_axis_.high, 50, 0, 3.0);
+    if (out_ == nullptr && !OpenOutput())
+        return kStFatal;
+
+    // a worker's next job with the same definitions only resets the histograms
+    histograms_->ClearDefinitions();
+    DefineHistograms();
+    histograms_->Book();
+
+    // everything written in Finish, in the order of the definitions
+    delete writer_;
+    writer_ = new StHistogramWriter();
+    outputs_.clear();
+    writer_->SetSparse(sparse_output_);
+    if (out_compression_ >= 0) {
+        writer_->SetCompressionSettings(out_compression_);
+        out_->SetCompressionSettings(out_compression_);
+    }
+    for (unsigned i = 0; i < histograms_->Size(); ++i) {
+        outputs_.push_back(histograms_->Histogram(i));
+        writer_->Add(histograms_->Histogram(i), out_layout_ == kFamilyLayout ? histograms_->Family(i) : "");
+    }
+    for (unsigned i = 0; i < histograms_->Cubes(); ++i)
+        writer_->Add(histograms_->Cube(i), out_layout_ == kFamilyLayout ? histograms_->CubeFamily(i) : "");
 
     return kStOK;
 }
 
+void StEfficiencyAssessor::DefineHistograms() {
+    // one line per histogram: name, title, family, the stage of Make it is
+    // filled at, and the variable & binning of each axis. Histograms are
+    // written in this order
+    Registry::Axis cent(Registry::kCentrality, cent_axis_);
+    Registry::Axis pt(Registry::kPt, pt_axis_);
+    Registry::Axis ptExt(Registry::kPt, 100, pt_axis_.low, pt_axis_.high);
+    Registry::Axis nhit(Registry::kNhit, 50, 0, 50);
+    Registry::Axis dca(Registry::kDca, 50, 0, 3.0);
+    Registry::Axis nhitPoss(Registry::kNhitPoss, 50, 0, 50);
+    Registry::Axis eta(Registry::kEta, 50, -1, 1);
+    Registry::Axis phi(Registry::kPhi, 50, -TMath::Pi(), TMath::Pi());
+    Registry::Axis fitFrac(Registry::kFitFrac, 50, 0, 1);
+    StHistogramRegistry& h = *histograms_;
+
+    h.Define("vz", ";v_{z}[cm]", "event", Registry::kEvent, Registry::Axis(Registry::kVz, 60, -30, 30));
+    h.Define("refmult", ";refmult", "event", Registry::kEvent, Registry::Axis(Registry::kRefMult, 800, 0, 800));
+    h.Define("grefmult", ";grefmult", "event", Registry::kEvent, Registry::Axis(Registry::kGRefMult, 800, 0, 800));
+    h.Define("centrality", ";centrality", "event", Registry::kEvent, cent);
+    h.Define("mcrecotracks", ";cent;mc tracks;reco tracks", "mc", Registry::kTrackCounts, cent,
+             Registry::Axis(Registry::kMcTracks, 50, 0, 50), Registry::Axis(Registry::kRecoTracks, 50, 0, 50));
+    h.Define("mctracks", ";cent;pt", "mc", Registry::kMcTrack, cent, pt);
+    h.Define("recotracks", ";cent;pt", "recocut", Registry::kRecoTrackCut, cent, pt);
+
+    h.Define("mceta", ";cent;pt;#eta", "mc", Registry::kMcTrack, cent, pt, eta);
+    h.Define("mcphi", ";cent;pt;#phi", "mc", Registry::kMcTrack, cent, pt, phi);
+
+    h.Define("reconhit", ";cent;pt;nhit", "reco", Registry::kRecoTrack, cent, pt, nhit);
+    h.Define("recodca", ";cent;pt;DCA[cm]", "reco", Registry::kRecoTrack, cent, pt, dca);
+    h.Define("reconhitposs", ";cent;pt;nhitposs", "reco", Registry::kRecoTrack, cent, pt, nhitPoss);
+    h.Define("recoeta", ";cent;pt;#eta", "reco", Registry::kRecoTrack, cent, pt, eta);
+    h.Define("recophi", ";cent;pt;#phi", "reco", Registry::kRecoTrack, cent, pt, phi);
+    h.Define("recofitfrac", ";cent;pt;fitfrac", "reco", Registry::kRecoTrack, cent, pt, fitFrac);
+    h.Define("recodcascale", ";cent;pt;DCA[cm]", "reco", Registry::kRecoTrackScale, cent, pt, dca);
+
+    h.Define("reconhitcut", ";cent;pt;nhit", "recocut", Registry::kRecoTrackCut, cent, pt, nhit);
+    h.Define("recodcacut", ";cent;pt;DCA[cm]", "recocut", Registry::kRecoTrackCut, cent, pt, dca);
+    h.Define("reconhitposscut", ";cent;pt;nhitposs", "recocut", Registry::kRecoTrackCut, cent, pt, nhitPoss);
+    h.Define("recoetacut", ";cent;pt;#eta", "recocut", Registry::kRecoTrackCut, cent, pt, eta);
+    h.Define("recophicut", ";cent;pt;#phi", "recocut", Registry::kRecoTrackCut, cent, pt, phi);
+    h.Define("recocutfitfrac", ";cent;pt;fitfrac", "recocut", Registry::kRecoTrackCut, cent, pt, fitFrac);
+
+    h.Define("datanhit", ";cent;pt;nhit", "data", Registry::kDataTrackCut, cent, pt, nhit);
+    h.Define("datadca", ";cent;pt;DCA[cm]", "data", Registry::kDataTrackCut, cent, pt, dca);
+    h.Define("datanhitposs", ";cent;pt;nhitposs", "data", Registry::kDataTrackCut, cent, pt, nhitPoss);
+    h.Define("dataeta", ";cent;pt;#eta", "data", Registry::kDataTrackCut, cent, pt, eta);
+    h.Define("dataphi", ";cent;pt;#phi", "data", Registry::kDataTrackCut, cent, pt, phi);
+    h.Define("datafitfrac", ";cent;pt;fitfrac", "data", Registry::kDataTrackCut, cent, pt, fitFrac);
+    h.Define("datadcascale", ";cent;pt;DCA[cm]", "data", Registry::kDataTrackScale, cent, pt, dca);
+
+    h.Define("recocutdcaext", ";cent;pt;DCA[cm]", "recocut", Registry::kRecoTrackCut, cent, ptExt, dca);
+    h.Define("datadcaext", ";cent;pt;DCA[cm]", "data", Registry::kDataTrackCut, cent, ptExt, dca);
+
+    // the differential study - every axisDef, then the observable (see SetDifferentialOutput)
+    std::vector<Registry::Axis> axes;
+    axes.push_back(Registry::Axis(Registry::kLumi, lumi_axis_));
+    axes.push_back(cent);
+    axes.push_back(Registry::Axis(Registry::kVz, vz_axis_));
+    axes.push_back(pt);
+    axes.push_back(Registry::Axis(Registry::kEta, eta_axis_));
+    axes.push_back(Registry::Axis(Registry::kPhi, phi_axis_));
+    std::string title = ";lumi;cent;v_{z}[cm];pt;#eta;#phi";
+    std::vector<Registry::Axis> dcaCube(axes), nhitCube(axes), nhitPossCube(axes);
+    dcaCube.push_back(Registry::Axis(Registry::kDca, 30, 0, 3.0));
+    nhitCube.push_back(Registry::Axis(Registry::kNhit, 40, 10, 50));
+    nhitPossCube.push_back(Registry::Axis(Registry::kNhitPoss, 40, 10, 50));
+
+    h.Define("diffrecodca", title + ";DCA[cm]", "differential", Registry::kRecoTrackCut, dcaCube);
+    h.Define("diffreconhit", title + ";nhit", "differential", Registry::kRecoTrackCut, nhitCube);
+    h.Define("diffreconhitposs", title + ";nhitposs", "differential", Registry::kRecoTrackCut, nhitPossCube);
+    h.Define("diffdatadca", title + ";DCA[cm]", "differential", Registry::kDataTrackCut, dcaCube);
+    h.Define("diffdatanhit", title + ";nhit", "differential", Registry::kDataTrackCut, nhitCube);
+    h.Define("diffdatanhitposs", title + ";nhitposs", "differential", Registry::kDataTrackCut, nhitPossCube);
+}
+
+void StEfficiencyAssessor::EnableFamily(std::string family, bool flag) {
+    histograms_->EnableFamily(family, flag);
+}
+
+bool StEfficiencyAssessor::FamilyEnabled(std::string family) const {
+    return histograms_->FamilyEnabled(family);
+}
+
+void StEfficiencyAssessor::SetDifferentialOutput(bool flag, Long64_t maxBytes) {
+    histograms_->EnableFamily("differential", flag);
+    histograms_->SetCubeMemory(maxBytes);
+}
+
+bool StEfficiencyAssessor::DifferentialOutput() const {
+    return histograms_->FamilyEnabled("differential");
+}
+
+bool StEfficiencyAssessor::WriteDifferentialOutput() {
+    for (unsigned i = 0; i < histograms_->Cubes(); ++i) {
+        StDifferentialCube* cube = histograms_->Cube(i);
+        LOG_INFO << "differential: " << cube->GetName() << ": " << cube->Entries() << " entries in "
+                 << cube->Blocks() << " of " << cube->OuterCells() << " blocks, "
+                 << cube->Bytes() / (1024 * 1024) << " MB, " << cube->OutOfRange() << " outside the axes" << endm;
+        if (cube->Dropped() > 0) {
+            LOG_WARN << "differential: " << cube->GetName() << ": " << cube->Dropped()
+                     << " fills dropped at the memory limit - raise it with SetDifferentialOutput" << endm;
+        }
+    }
+    if (projections_.empty())
+        return true;
+
+    // the projections are written after the cubes, and are not kept
+    StHistogramWriter writer;
+    if (out_compression_ >= 0)
+        writer.SetCompressionSettings(out_compression_);
+    std::vector<TH1*> projected;
+    for (unsigned i = 0; i < histograms_->Cubes(); ++i) {
+        StDifferentialCube* cube = histograms_->Cube(i);
+        for (unsigned j = 0; j < projections_.size(); ++j) {
+            std::vector<std::string> axes;
+            std::string name = cube->GetName();
+            std::stringstream stream(projections_[j]);
+            std::string axis;
+            bool found = true;
+            while (std::getline(stream, axis, ':')) {
+                axes.push_back(axis);
+                name += "_" + axis;
+                found = found && cube->AxisIndex(axis) >= 0;
+            }
+            if (!found)
+                continue;
+            TH1* hist = cube->Project(name.c_str(), axes);
+            if (hist == nullptr)
+                continue;
+            projected.push_back(hist);
+            writer.Add(hist, out_layout_ == kFamilyLayout ? histograms_->CubeFamily(i) : "");
+        }
+    }
+    bool written = writer.Write(out_) >= 0;
+    if (!written)
+        LOG_ERROR << "could not write the differential projections to " << out_->GetName() << endm;
+    else
+        LOG_INFO << "differential: " << projected.size() << " projections written" << endm;
+    for (size_t i = 0; i < projected.size(); ++i)
+        delete projected[i];
+    return written;
+}
+
+bool StEfficiencyAssessor::WriteFlatOutput() {
+    StFlatResultWriter flat;
+    const axisDef* axes[6] = {&lumi_axis_, &cent_axis_, &vz_axis_, &pt_axis_, &eta_axis_, &phi_axis_};
+    const char* names[6] = {"lumi", "cent", "vz", "pt", "eta", "phi"};
+    for (int i = 0; i < 6; ++i)
+        flat.AddAxis(names[i], axes[i]->nBins, axes[i]->low, axes[i]->high, axes[i]->edgeArray());
+    for (unsigned i = 0; i < outputs_.size(); ++i)
+        flat.Add(outputs_[i]);
+    return flat.Write(flat_output_) >= 0;
+}
+
+bool StEfficiencyAssessor::WriteEfficiencyTable() {
+    // reconstructed tracks passing the track cuts over all MC tracks, summed
+    // into the table bins by bin center
+    const axisDef* axes[3] = {&cent_axis_, &pt_axis_, &eta_axis_};
+    const char* names[3] = {"cent", "pt", "eta"};
+    TH1* num = histograms_->Get(efficiency_eta_ ? "recoetacut" : "recotracks");
+    TH1* den = histograms_->Get(efficiency_eta_ ? "mceta" : "mctracks");
+    unsigned dim = efficiency_eta_ ? 3 : 2;
+    if (num == nullptr || den == nullptr) {
+        LOG_ERROR << "efficiency table needs the mc & recocut histograms: family disabled" << endm;
+        return false;
+    }
+
+    StEfficiencyTable table;
+    for (unsigned i = 0; i < dim; ++i)
+        table.AddAxis(names[i], axes[i]->nBins, axes[i]->low, axes[i]->high, axes[i]->edgeArray());
+    std::vector<double> reco(table.Cells(), 0.0);
+    std::vector<double> mc(table.Cells(), 0.0);
+    const TAxis* histAxes[3] = {num->GetXaxis(), num->GetYaxis(), num->GetZaxis()};
+    for (int x = 1; x <= num->GetNbinsX(); ++x) {
+        for (int y = 1; y <= num->GetNbinsY(); ++y) {
+            for (int z = 1; z <= num->GetNbinsZ(); ++z) {
+                int bins[3] = {x, y, z};
+                long cell = 0;
+                for (unsigned i = 0; i < dim && cell >= 0; ++i) {
+                    int bin = axes[i]->bin(histAxes[i]->GetBinCenter(bins[i]));
+                    cell = bin < 0 || bin >= (int) axes[i]->nBins ? -1 : cell * axes[i]->nBins + bin;
+                }
+                if (cell < 0)
+                    continue;
+                reco[cell] += num->GetBinContent(x, y, z);
+                mc[cell] += den->GetBinContent(x, y, z);
+            }
+        }
+    }
+
+    std::vector<float> eff(table.Cells(), 0.0f);
+    std::vector<float> err(table.Cells(), 0.0f);
+    for (size_t i = 0; i < table.Cells(); ++i) {
+        if (mc[i] <= 0.0)
+            continue;
+        double e = reco[i] / mc[i];
+        eff[i] = e;
+        err[i] = sqrt(std::max(e * (1.0 - e), 0.0) / mc[i]);
+    }
+    if (!table.SetValues(eff, err) || !table.Write(efficiency_output_.c_str())) {
+        LOG_ERROR << "could not write efficiency table " << efficiency_output_ << endm;
+        return false;
+    }
+    LOG_INFO << "efficiency table: " << table.Cells() << " bins written to " << efficiency_output_ << endm;
+    return true;
+}
+
+bool StEfficiencyAssessor::InitCheckpoint() {
+    events_made_ = 0;
+    last_checkpoint_event_ = 0;
+    last_checkpoint_time_ = Now();
+    checkpoints_written_ = 0;
+    delete checkpoint_writer_;
+    checkpoint_writer_ = nullptr;
+    delete resume_;
+    resume_ = nullptr;
+    if (checkpoint_path_.empty())
+        return true;
+
+    // checkpoints are scratch files - written fast, always flat
+    checkpoint_writer_ = new StHistogramWriter();
+    checkpoint_writer_->SetCompressionSettings(StHistogramWriter::ScratchCompression());
+    for (unsigned i = 0; i < outputs_.size(); ++i)
+        checkpoint_writer_->Add(outputs_[i]);
+    std::vector<StDifferentialCube*> cubes;
+    for (unsigned i = 0; i < histograms_->Cubes(); ++i) {
+        cubes.push_back(histograms_->Cube(i));
+        checkpoint_writer_->Add(histograms_->Cube(i));
+    }
+
+    if (!StCheckpoint::Exists(checkpoint_path_)) {
+        LOG_INFO << "checkpoint: saving to " << checkpoint_path_ << " every " << checkpoint_events_
+                 << " events or " << checkpoint_seconds_ << " s" << endm;
+        return true;
+    }
+
+    // a checkpoint that can not be used is never overwritten by a fresh start
+    resume_ = StCheckpoint::Load(checkpoint_path_, outputs_, cubes);
+    if (resume_ == nullptr) {
+        LOG_ERROR << "checkpoint: could not resume from " << checkpoint_path_ << " - remove it to start over" << endm;
+        return false;
+    }
+    if (resume_->mMatchMode != match_mode_ || !cuts_.RestoreCounters(resume_->mCutCounters)) {
+        LOG_ERROR << "checkpoint: " << checkpoint_path_ << " was written with different options" << endm;
+        return false;
+    }
+    // the fill statistics continue from the restored sums, as in a job never interrupted
+    histograms_->Sync();
+    mc_header_reads_ = resume_->mMcHeaderReads;
+    mc_track_reads_ = resume_->mMcTrackReads;
+    matched_events_ = resume_->mMatchedEvents;
+    orphan_mu_events_ = resume_->mOrphanMuEvents;
+    orphan_mc_events_ = resume_->mOrphanMcEvents;
+    unsorted_mu_events_ = resume_->mUnsortedMuEvents;
+    events_made_ = resume_->mEvents;
+    last_checkpoint_event_ = resume_->mEvents;
+
+    // muDst events before the checkpoint are read with every branch off
+    if (match_mode_ != kMiniMcDriven && resume_->mMuEntry > 0)
+        muDstMaker_->SetStatus("*", 0);
+    LOG_INFO << "checkpoint: resuming from " << checkpoint_path_ << " after " << resume_->mEvents
+             << " events" << endm;
+    return true;
+}
+
+bool StEfficiencyAssessor::FastForward() {
+    if (match_mode_ != kMiniMcDriven) {
+        Long64_t entry = muDstMaker_->chain()->GetReadEntry();
+        if (entry < resume_->mMuEntry) {
+            // the next event is the first one processed - it is read in full
+            if (entry + 1 == resume_->mMuEntry)
+                RestoreMuDstStatus();
+            return true;
+        }
+        std::string file = BaseName(muDstMaker_->GetFile());
+        if (file != resume_->mMuFile.Data()) {
+            LOG_WARN << "checkpoint: muDst entry " << entry << " is in " << file << ", the checkpoint was taken in "
+                     << resume_->mMuFile << " - are the lists the same?" << endm;
+        }
+    }
+
+    // the miniMC cursor only matters to the modes that walk the chain
+    if (match_mode_ == kMergeJoin || match_mode_ == kMiniMcDriven) {
+        if (pair_by_file_)
+            SwitchPair();
+        current_ = resume_->mMcEntry;
+        current_matched_ = resume_->mMcMatched;
+        mc_exhausted_ = resume_->mMcExhausted;
+        last_mu_key_ = resume_->mLastMuKey;
+        if (!mc_exhausted_ && !ReadMcHeader(current_))
+            mc_exhausted_ = true;
+    }
+    LOG_INFO << "checkpoint: resumed at event " << resume_->mEvents << endm;
+    delete resume_;
+    resume_ = nullptr;
+    return false;
+}
+
+void StEfficiencyAssessor::RestoreMuDstStatus() {
+    if (prune_mudst_)
+        PruneMuDstArrays();
+    else
+        muDstMaker_->SetStatus("*", 1);
+}
+
+void StEfficiencyAssessor::WriteCheckpoint() {
+    StCheckpoint state;
+    state.mEvents = events_made_;
+    if (match_mode_ != kMiniMcDriven) {
+        state.mMuEntry = muDstMaker_->chain()->GetReadEntry();
+        state.mMuFile = BaseName(muDstMaker_->GetFile()).c_str();
+    }
+    state.mMatchMode = match_mode_;
+    state.mMcEntry = current_;
+    state.mMcMatched = current_matched_;
+    state.mMcExhausted = mc_exhausted_;
+    state.mLastMuKey = last_mu_key_;
+    state.mMcHeaderReads = mc_header_reads_;
+    state.mMcTrackReads = mc_track_reads_;
+    state.mMatchedEvents = matched_events_;
+    state.mOrphanMuEvents = orphan_mu_events_;
+    state.mOrphanMcEvents = orphan_mc_events_;
+    state.mUnsortedMuEvents = unsorted_mu_events_;
+    state.mCutCounters = cuts_.Counters();
+
+    // a failed checkpoint is retried at the next interval
+    histograms_->Flush();
+    last_checkpoint_event_ = events_made_;
+    last_checkpoint_time_ = Now();
+    if (state.Save(checkpoint_path_, *checkpoint_writer_)) {
+        checkpoints_written_++;
+        LOG_DEBUG << "checkpoint: " << events_made_ << " events saved to " << checkpoint_path_ << endm;
+    }
+}
+
 bool StEfficiencyAssessor::LoadEvent() {
+    muInputEvent_ = nullptr;
+    if (match_mode_ == kMiniMcDriven)
+        return MiniMcDrivenEvent();
+
     muDst_ = muDstMaker_->muDst();
     if (muDst_ == nullptr) {
         LOG_ERROR << "Could not load MuDst" << endm;
-        return kStErr;
+        return false;
     }
     muInputEvent_ = muDst_->event();
     if (muInputEvent_ == nullptr) {
         LOG_ERROR << "Could not load MuDstEvent" << endm;
-        return kStErr;
+        return false;
     }
 
     int eventID = muInputEvent_->eventId();
     int runID = muInputEvent_->runId();
 
-    // now try to match the event to a miniMC event in the chain
+    if (pair_by_file_ && !SwitchPair())
+        return false;
 
-    int nTries = chain_->GetEntries();
+    if (match_mode_ == kMergeJoin)
+        return MergeJoinEvent(runID, eventID);
 
-    if (event_->eventId() == eventID &&
-            event_->runId() == runID)
-        return true;
+    // now try to match the event to a miniMC event in the chain
+    if (index_ == nullptr && !BuildIndex())
+        return false;
 
-    while (nTries >= 0) {
+    if (mc_event_->eventId == eventID &&
+            mc_event_->runId == runID)
+        return true;
 
-        current_++;
-        if (current_ >= chain_->GetEntries())
-            current_ = 0;
-        nTries--;
+    Long64_t entry = index_->Find(runID, eventID);
+    if (entry < 0) {
+        LOG_ERROR << "could not match event to miniMC" << endm;
+        return false;
+    }
 
-        chain_->GetEntry(current_);
+    current_ = entry;
+    return ReadMcHeader(current_);
+}
 
-        if (event_->eventId() == eventID &&
-                event_->runId() == runID)
+bool StEfficiencyAssessor::MergeJoinEvent(int runID, int eventID) {
+    ULong64_t key = StEventIndex::Key(runID, eventID);
+    if (key < last_mu_key_)
+        unsorted_mu_events_++;
+    last_mu_key_ = key;
+
+    // walk the miniMC stream forward, reading only the id leaves, until it
+    // reaches or passes the muDst event - the chain is never rewound
+    while (!mc_exhausted_) {
+        ULong64_t mcKey = StEventIndex::Key(mc_event_->runId, mc_event_->eventId);
+        if (mcKey == key) {
+            if (!current_matched_) {
+                current_matched_ = true;
+                matched_events_++;
+            }
             return true;
+        }
+        if (mcKey > key)
+            break;
+
+        if (!current_matched_)
+            orphan_mc_events_++;
+        current_++;
+        current_matched_ = false;
+        if (!ReadMcHeader(current_))
+            mc_exhausted_ = true;
     }
 
-    if (nTries < 0) {
-        LOG_ERROR << "could not match event to miniMC" << endm;
+    orphan_mu_events_++;
+    return false;
+}
+
+bool StEfficiencyAssessor::MiniMcDrivenEvent() {
+    if (mu_index_ == nullptr && !BuildMuIndex())
         return false;
+
+    // current_matched_ marks the miniMC entry at current_ as used - the
+    // first call starts on the entry loaded by OpenMcInput
+    while (!mc_exhausted_) {
+        if (current_matched_) {
+            current_++;
+            current_matched_ = false;
+            if (!ReadMcHeader(current_)) {
+                mc_exhausted_ = true;
+                break;
+            }
+        }
+        current_matched_ = true;
+
+        Long64_t muEntry = mu_index_->Find(mc_event_->runId, mc_event_->eventId);
+        if (muEntry < 0) {
+            orphan_mc_events_++;
+            continue;
+        }
+
+        // only the partner muDst event is read - everything in between is skipped
+        if (muDstMaker_->Make((int) muEntry) != kStOK) {
+            LOG_ERROR << "could not read muDst entry " << muEntry << endm;
+            return false;
+        }
+        muDst_ = muDstMaker_->muDst();
+        if (muDst_ == nullptr || muDst_->event() == nullptr) {
+            LOG_ERROR << "Could not load MuDstEvent" << endm;
+            return false;
+        }
+        muInputEvent_ = muDst_->event();
+        matched_events_++;
+        return true;
     }
+    return false;
+}
 
+bool StEfficiencyAssessor::BuildMuIndex() {
+    // the ids sit in the single-element MuEvent TClonesArray
+    delete mu_index_;
+    mu_index_ = new StEventIndex("MuDst", "MuEvent.mEventInfo.mRunId", "MuEvent.mEventInfo.mId");
+    mu_index_->SetCountBranch("MuEvent");
+    mu_index_->SetSidecarDirectory(index_dir_);
+    mu_index_->UseSidecars(use_index_sidecars_);
+    if (!mu_index_->Build(muDstMaker_->chain())) {
+        LOG_ERROR << "could not build muDst event index" << endm;
+        delete mu_index_;
+        mu_index_ = nullptr;
+        return false;
+    }
     return true;
 }
 
+bool StEfficiencyAssessor::ReadMcHeader(Long64_t entry) {
+    if (prefetcher_ != nullptr) {
+        const StMiniMcFlatEvent* event = prefetcher_->Take(entry);
+        if (event != nullptr) {
+            mc_event_ = event;
+            mc_prefetched_ = true;
+            return true;
+        }
+        // out of the prefetch window - read it here, and move the window
+        prefetcher_->Seek(entry + 1);
+    }
+    mc_event_ = &reader_->Event();
+    mc_prefetched_ = false;
+    return reader_->ReadHeader(entry);
+}
 
+bool StEfficiencyAssessor::ReadMcTracks() {
+    // prefetched events are decoded in full
+    if (mc_prefetched_)
+        return true;
+    return reader_->ReadTracks();
+}
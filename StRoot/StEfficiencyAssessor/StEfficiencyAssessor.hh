@@ -4,13 +4,14 @@
 
 #include "centrality_def.hh"
 #include "StEventCuts.hh"
+#include "StAxisDef.hh"
 
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
 
 #include "StMaker.h"
-#include "StMiniMcEvent/StMiniMcEvent.h"
 #include "TChain.h"
 #include "TFile.h"
 #include "TH3F.h"
@@ -22,49 +23,182 @@
 
 #include "StRefMultCorr/StRefMultCorr.h"
 
-struct axisDef {
-    unsigned nBins;
-    double low;
-    double high;
-
-    axisDef() : nBins(1), low(0), high(1) {}
-
-    axisDef(unsigned n, double l, double h)
-        : nBins(n), low(l), high(h) {}
-
-    axisDef(const axisDef& rhs)
-        : nBins(rhs.nBins), low(rhs.low), high(rhs.high) {};
-
-    double width() const {return (high - low) / nBins;}
-
-    bool valid() const {return nBins > 0 && width() > 0.0;}
-
-    int bin(double val) const {
-        for (unsigned i = 0; i < nBins; ++i) {
-            if (val > low + i * width() &&
-                    val <= low + (i + 1) * width()) {
-                return i;
-            }
-        }
-        return -1;
-    }
-};
+class StEventIndex;
+class StMiniMcReader;
+class StMiniMcPrefetcher;
+class StStageIn;
+class StHistogramWriter;
+class StCheckpoint;
+class StHistogramRegistry;
+struct StMiniMcFlatEvent;
 
 class StEfficiencyAssessor : public StMaker {
     public:
+        // how muDst events are matched to miniMC events
+        //   kIndexMatch: hash lookup of (runId, eventId), any input order
+        //   kMergeJoin:  both streams sorted by (runId, eventId), walked
+        //                forward together in a single pass
+        //   kMiniMcDriven: the miniMC chain is read in order, and only the
+        //                muDst events it points to are read, by index. The
+        //                StMuDstMaker is switched off, and Make returns
+        //                kStEOF at the end of the miniMC chain
+        enum MatchMode {kIndexMatch, kMergeJoin, kMiniMcDriven};
+
+        // how the histograms are laid out in the output file
+        //   kFlatLayout:   all in the top directory
+        //   kFamilyLayout: one directory per family - event, mc, reco,
+        //                  recocut & data
+        enum OutputLayout {kFlatLayout, kFamilyLayout};
+
         StEfficiencyAssessor(TChain* chain, std::string outputFile = "StEfficiencyAssessor.root");
 
         ~StEfficiencyAssessor();
 
-        // loads a new chain
+        // loads a new chain - the input of the previous chain is released
+        // first (see UnloadTree)
         bool LoadTree(TChain* chain);
 
-        // set axis bounds
+        // releases everything tied to the current miniMC chain & muDst
+        // maker - reader, index, prefetcher, stage-in - so both can be
+        // deleted. A worker calls it at the end of each job, before the job's
+        // chains go away, and reuses the assessor with LoadTree
+        void UnloadTree();
+
+        // the output file is opened at construction, and again in Init if a
+        // previous job's Finish closed it. Setting a new path closes the
+        // current file
+        void SetOutputFile(std::string outputFile);
+        std::string OutputFile() const {return out_path_;}
+
+        // the (runId, eventId) index of the miniMC chain is cached in a sidecar
+        // file per miniMC file - by default next to the miniMC file, or in dir
+        void SetIndexDirectory(std::string dir) {index_dir_ = dir;}
+        std::string IndexDirectory() const     {return index_dir_;}
+        void UseIndexSidecars(bool flag)        {use_index_sidecars_ = flag;}
+        bool UseIndexSidecars() const           {return use_index_sidecars_;}
+
+        // select the matching strategy - kIndexMatch by default
+        void SetMatchMode(MatchMode mode) {match_mode_ = mode;}
+        MatchMode GetMatchMode() const    {return match_mode_;}
+
+        // TTreeCache size for the miniMC chain in bytes - 0 sizes it from the
+        // branches that are read, a negative size disables the cache
+        void SetMiniMcCacheSize(Long64_t bytes) {cache_size_ = bytes;}
+        Long64_t MiniMcCacheSize() const        {return cache_size_;}
+
+        // read ahead the next miniMC file while the current one is processed
+        void UseMiniMcReadAhead(bool flag) {read_ahead_ = flag;}
+        bool UseMiniMcReadAhead() const    {return read_ahead_;}
+
+        // decode miniMC entries ahead of time on a background thread, into a
+        // ring of depth events - 0 (the default) reads on the main thread.
+        // Only used when the miniMC events are read in order: in kMergeJoin
+        // & kMiniMcDriven mode, or with file pairing
+        void SetPrefetchDepth(unsigned depth) {prefetch_depth_ = depth;}
+        unsigned PrefetchDepth() const        {return prefetch_depth_;}
+
+        // pair each muDst file with the miniMC file of the same run & sequence
+        // number, and keep only that file open while the muDst is processed.
+        // muDst files without a readable partner are skipped, and their
+        // events counted as unmatched
+        void PairByFile(bool flag) {pair_by_file_ = flag;}
+        bool PairByFile() const    {return pair_by_file_;}
+
+        // in Init, every muDst array that Make does not read is switched off
+        // (see MuDstArrays()). Arrays needed by other makers in the chain can
+        // be added, or pruning turned off entirely
+        void PruneMuDst(bool flag)            {prune_mudst_ = flag;}
+        bool PruneMuDst() const               {return prune_mudst_;}
+        void AddMuDstArray(std::string array) {extra_mudst_arrays_.push_back(array);}
+        std::vector<std::string> MuDstArrays() const;
+
+        // copy the next lookahead muDst & miniMC files to dir (e.g. $SCRATCH)
+        // in the background, using at most maxBytes of disk. Files that do not
+        // fit are read in place. Off unless a directory is given. Only chains
+        // read in order are staged - not the muDst chain in kMiniMcDriven mode,
+        // nor the miniMC chain in kIndexMatch mode
+        void SetStageIn(std::string dir, unsigned lookahead = 2, Long64_t maxBytes = 20000000000LL) {
+            stage_dir_ = dir;
+            stage_lookahead_ = lookahead;
+            stage_max_bytes_ = maxBytes;
+        }
+        std::string StageDirectory() const {return stage_dir_;}
+
+        // the histograms are written in Finish with the given ROOT
+        // compression settings - see StHistogramWriter::ScratchCompression()
+        // and ArchiveCompression(). The layout is fixed in Init
+        void SetOutputCompression(Int_t settings) {out_compression_ = settings;}
+        Int_t OutputCompression() const          {return out_compression_;}
+        void SetOutputLayout(OutputLayout layout) {out_layout_ = layout;}
+        OutputLayout GetOutputLayout() const      {return out_layout_;}
+
+        // the histograms are booked by family - event, mc, reco, recocut,
+        // data & differential (see DefineHistograms). A disabled family is
+        // neither booked, filled nor written, and the track loops only it
+        // needs are skipped. All but differential are enabled by default;
+        // set before Init
+        void EnableFamily(std::string family, bool flag);
+        bool FamilyEnabled(std::string family) const;
+
+        // the differential study: matched & data tracks passing the track
+        // cuts in bins of lumi, cent, vz, pt, eta & phi (the axisDefs), and
+        // of their dca, nhit or nhitposs - one StDifferentialCube each. The
+        // cubes only allocate the cells the data reaches, and together take
+        // at most maxBytes (0: unlimited) - fills beyond that are dropped,
+        // and reported in Finish. Off by default; set before Init
+        void SetDifferentialOutput(bool flag, Long64_t maxBytes = 1000000000LL);
+        bool DifferentialOutput() const;
+
+        // also write every cube summed onto axes - 1 to 3 axis names joined
+        // by ':', e.g. "pt:eta" - as <cube>_pt_eta. Cubes without one of
+        // the axes are skipped
+        void AddDifferentialProjection(std::string axes) {projections_.push_back(axes);}
+
+        // write every histogram as StSparseHistogram, a list of its filled
+        // bins (read them with StSparseHistogram::Get). Off by default - jobs
+        // whose outputs are merged must all use the same setting
+        void SetSparseOutput(bool sparse) {sparse_output_ = sparse;}
+        bool SparseOutput() const         {return sparse_output_;}
+
+        // also write the result to path as a flat, memory-mappable file - the
+        // axisDefs and every histogram's bin arrays, read with StFlatResult.hh.
+        // Off unless a path is given
+        void SetFlatOutput(std::string path) {flat_output_ = path;}
+        std::string FlatOutput() const       {return flat_output_;}
+
+        // also write the efficiency reco / mc in the bins of the centrality &
+        // pt axes (and the eta axis, if withEta) to path, with binomial
+        // uncertainties - read it with StEfficiencyTable.hh. Off unless a
+        // path is given
+        void SetEfficiencyOutput(std::string path, bool withEta = false) {
+            efficiency_output_ = path;
+            efficiency_eta_ = withEta;
+        }
+        std::string EfficiencyOutput() const {return efficiency_output_;}
+
+        // save the histograms, counters & input position to path every
+        // events events or seconds seconds, whichever comes first. A job
+        // that finds a checkpoint at path in Init continues from it - it has
+        // to run on the same lists, with the same cuts & options. The
+        // checkpoint is removed once Finish has written the output
+        void SetCheckpoint(std::string path, Long64_t events = 10000, double seconds = 600) {
+            checkpoint_path_ = path;
+            checkpoint_events_ = events;
+            checkpoint_seconds_ = seconds;
+        }
+        std::string CheckpointPath() const {return checkpoint_path_;}
+
+        // set axis bounds - the pt axis also takes variable bins, as its
+        // nBins + 1 edges. By default pt is binned by 0.1 GeV up to 2 GeV,
+        // and by 0.5 GeV above
         void SetDefaultAxes();
+        static axisDef DefaultCentralityAxis();
+        static axisDef DefaultPtAxis();
         void SetLuminosityAxis(unsigned n, double low, double high);
         void SetCentralityAxis(unsigned n, double low, double high);
         void SetVzAxis(unsigned n, double low, double high);
         void SetPtAxis(unsigned n, double low, double high);
+        void SetPtAxis(const std::vector<double>& edges);
         void SetEtaAxis(unsigned n, double low, double high);
         void SetPhiAxis(unsigned n, double low, double high);
 
@@ -107,19 +241,127 @@ class StEfficiencyAssessor : public StMaker {
         int InitInput();
         int InitOutput();
         bool LoadEvent();
+        bool BuildIndex();
+        bool MergeJoinEvent(int runID, int eventID);
+        bool MiniMcDrivenEvent();
+        bool BuildMuIndex();
+        bool ReadMcHeader(Long64_t entry);
+        bool ReadMcTracks();
+        bool OpenMcInput(TChain* chain);
+        bool ConfigureMcInput();
+        Long64_t McRemaining();
+        bool PrefetchInOrder() const;
+
+        void PruneMuDstArrays();
+        void StartStageIn();
+
+        bool BuildPairs();
+        bool SwitchPair();
+        bool SkipPair();
+        static std::string PairKey(std::string path);
 
         bool CheckAxes();
+        bool OpenOutput();
+        void DefineHistograms();
+
+        bool WriteFlatOutput();
+        bool WriteEfficiencyTable();
+        bool WriteDifferentialOutput();
+
+        bool InitCheckpoint();
+        bool FastForward();
+        void RestoreMuDstStatus();
+        void WriteCheckpoint();
 
         TChain* chain_;
         TFile* out_;
-
-        unsigned current_;
+        std::string out_path_;
+
+        StHistogramWriter* writer_; //!
+        Int_t out_compression_;
+        OutputLayout out_layout_;
+        bool sparse_output_;
+        std::string flat_output_;
+        std::string efficiency_output_;
+        bool efficiency_eta_;
+        std::vector<std::string> projections_;
+
+        // the histograms of the event loop, declared in DefineHistograms.
+        // They are owned by the registry, not by out_, and an Init with the
+        // same definitions only resets them. outputs_ holds every histogram
+        // written in Finish, in order
+        StHistogramRegistry* histograms_; //!
+        std::vector<TH1*> outputs_; //!
+
+        // checkpoints are written at the start of Make, before the event
+        // is processed. resume_ holds the checkpoint a job was started
+        // from, until the muDst & miniMC inputs are back at its position
+        std::string checkpoint_path_;
+        Long64_t checkpoint_events_;
+        double checkpoint_seconds_;
+        StHistogramWriter* checkpoint_writer_; //!
+        StCheckpoint* resume_; //!
+        Long64_t events_made_;
+        Long64_t last_checkpoint_event_;
+        double last_checkpoint_time_;
+        unsigned checkpoints_written_;
+
+        // the miniMC input currently read - chain_, or with file pairing
+        // a chain holding only the partner of the current muDst file
+        TChain* mc_input_; //!
+        TChain* pair_chain_; //!
+        bool pair_by_file_;
+        std::string pair_mu_file_;
+        bool pair_skipped_;  // the partner of pair_mu_file_ is unreadable
+        std::map<std::string, std::string> pair_files_; //!
+
+        // (runId, eventId) -> chain entry, built in Init
+        StEventIndex* index_; //!
+        std::string index_dir_;
+        bool use_index_sidecars_;
+        Long64_t current_;
+
+        // (runId, eventId) -> muDst chain entry, for kMiniMcDriven
+        StEventIndex* mu_index_; //!
+
+        // matched events, and events whose track arrays were decoded
+        Long64_t mc_header_reads_;
+        Long64_t mc_track_reads_;
+
+        // merge-join state: whether the entry at current_ has been
+        // matched, whether the chain is exhausted, and orphan counts
+        MatchMode match_mode_;
+        bool current_matched_;
+        bool mc_exhausted_;
+        ULong64_t last_mu_key_;
+        Long64_t matched_events_;
+        Long64_t orphan_mu_events_;
+        Long64_t orphan_mc_events_;
+        Long64_t unsorted_mu_events_;
+
+        StStageIn* stage_; //!
+        std::string stage_dir_;
+        unsigned stage_lookahead_;
+        Long64_t stage_max_bytes_;
+
+        bool prune_mudst_;
+        std::vector<std::string> extra_mudst_arrays_;
 
         StMuDstMaker* muDstMaker_;
         StMuDst* muDst_;
         StMuEvent* muInputEvent_;
 
-        StMiniMcEvent* event_;
+        // flat, leaf-level reader for the miniMC chain
+        StMiniMcReader* reader_; //!
+        Long64_t cache_size_;
+        bool read_ahead_;
+
+        // background decoding - mc_event_ points either into the reader
+        // or into the prefetch ring
+        StMiniMcPrefetcher* prefetcher_; //!
+        unsigned prefetch_depth_;
+        const StMiniMcFlatEvent* mc_event_; //!
+        bool mc_prefetched_;
 
         axisDef lumi_axis_;
         axisDef cent_axis_;
@@ -127,45 +369,6 @@ class StEfficiencyAssessor : public StMaker {
         axisDef pt_axis_;
         axisDef eta_axis_;
         axisDef phi_axis_;
-        
-        TH3D* mc_eta_;
-        TH3D* mc_phi_;
-
-        TH3D* reco_nhit_;
-        TH3D* reco_dca_;
-        TH3D* reco_nhitposs_;
-        TH3D* reco_eta_;
-        TH3D* reco_phi_;
-        TH3D* reco_fitfrac_;
-        TH3D* reco_dca_scale_;
-
-        TH3D* reco_cut_nhit_;
-        TH3D* reco_cut_dca_;
-        TH3D* reco_cut_nhitposs_;
-        TH3D* reco_cut_eta_;
-        TH3D* reco_cut_phi_;
-        TH3D* reco_cut_fitfrac_;
-
-        TH3D* data_nhit_;
-        TH3D* data_dca_;
-        TH3D* data_nhitposs_;
-        TH3D* data_eta_;
-        TH3D* data_phi_;
-        TH3D* data_fitfrac_;
-        TH3D* data_dca_scale_;
-
-        TH1D* vz_;
-        TH1D* refmult_;
-        TH1D* grefmult_;
-        TH1D* centrality_;
-
-        TH3D* mc_reco_tracks_;
-
-        TH2D* mc_tracks_;
-        TH2D* reco_tracks_;
-
-        TH3D* dca_reco_cut_ext_;
-        TH3D* dca_data_cut_ext_;
 
         int minFit_;
         double minFitFrac_;
@@ -0,0 +1,176 @@
+#include "StEfficiencyJob.hh"
+
+#include "St_base/StMessMgr.h"
+#include "StChain/StChain.h"
+#include "StarRoot/StMemStat.h"
+
+#include "StMuDSTMaker/COMMON/StMuDstMaker.h"
+
+#include "StEfficiencyAssessor.hh"
+#include "StEfficiencyWorker.hh"
+#include "StFileCatalog.hh"
+
+#include "TChain.h"
+#include "TStopwatch.h"
+
+#include <cstdlib>
+#include <iostream>
+
+ClassImp(StEfficiencyJob)
+
+StEfficiencyJob::StEfficiencyJob(const char* muFileList, const char* mcFileList, const char* nametag,
+                                 double dcaMax, int fitPoints, double fitFrac, int nFiles)
+  : mMuFileList(muFileList), mMcFileList(mcFileList), mNametag(nametag), mDcaMax(dcaMax),
+    mFitPoints(fitPoints), mFitFrac(fitFrac), mFiles(nFiles), mReportInterval(500),
+    mChain(nullptr), mMuDstMaker(nullptr), mAssessor(nullptr), mOwnsAssessor(kTRUE), mMcChain(nullptr),
+    mSetupTime(0), mLoopCpu(0), mLoopReal(0), mFinishTime(0) {}
+
+StEfficiencyJob::~StEfficiencyJob() {
+  // an assessor that outlives the job lets go of the job's inputs,
+  // and leaves the chain before it deletes its makers
+  if (mAssessor != nullptr && !mOwnsAssessor) {
+    mAssessor->UnloadTree();
+    mAssessor->Shunt(nullptr);
+  }
+  delete mChain;
+  delete mMcChain;
+}
+
+Bool_t StEfficiencyJob::Setup(StEfficiencyAssessor* assessor) {
+  if (mChain != nullptr) {
+    LOG_ERROR << "efficiency job: Setup called twice" << endm;
+    return kFALSE;
+  }
+  TStopwatch timer;
+
+  mChain = new StChain("StChain");
+  mMuDstMaker = new StMuDstMaker(0, 0, "", mMuFileList.c_str(), "", mFiles);
+
+  // the miniMC chain is built from the cached catalogs of both
+  // lists, leaving out miniMC files that can not match one of the
+  // muDST files the muDst maker reads
+  StFileCatalog mcCatalog("StMiniMcTree", "mRunId", "mEventId");
+  if (!mcCatalog.Load(mMcFileList.c_str())) {
+    LOG_ERROR << "efficiency job: could not read the miniMC list " << mMcFileList << endm;
+    return kFALSE;
+  }
+  StFileCatalog muCatalog("MuDst", "MuEvent.mEventInfo.mRunId", "MuEvent.mEventInfo.mId");
+  if (muCatalog.Load(mMuFileList.c_str(), mFiles))
+    mcCatalog.Restrict(muCatalog);
+  else
+    LOG_WARN << "efficiency job: could not catalog " << mMuFileList << " - the whole miniMC list is used" << endm;
+  mMcChain = mcCatalog.MakeChain();
+  if (mMcChain == nullptr || mMcChain->GetNtrees() == 0) {
+    LOG_ERROR << "efficiency job: no miniMC files from " << mMcFileList << endm;
+    return kFALSE;
+  }
+
+  std::string output = mNametag + ".root";
+  if (assessor != nullptr) {
+    mAssessor = assessor;
+    mOwnsAssessor = kFALSE;
+    mChain->AddMaker(mAssessor);
+    mAssessor->SetOutputFile(output);
+    if (!mAssessor->LoadTree(mMcChain)) {
+      LOG_ERROR << "efficiency job: could not load the miniMC chain of " << mMcFileList << endm;
+      return kFALSE;
+    }
+  }
+  else {
+    mAssessor = new StEfficiencyAssessor(mMcChain, output);
+  }
+  mAssessor->AddGeantId(8);
+  mAssessor->AddGeantId(9);
+  mAssessor->SetDCAMax(mDcaMax);
+  mAssessor->SetMinFitPoints(mFitPoints);
+  mAssessor->SetMinFitFrac(mFitFrac);
+
+  // event cuts
+  mAssessor->EventCuts().AddTrigger(450010);
+  mAssessor->EventCuts().AddTrigger(450020);
+
+  mSetupTime = timer.RealTime();
+  return kTRUE;
+}
+
+Long64_t StEfficiencyJob::Run(Long64_t nEvents) {
+  if (mChain == nullptr && !Setup())
+    return -1;
+
+  StMemStat memory;
+  memory.PrintMem(NULL);
+
+  TStopwatch init;
+  if (mChain->Init()) {
+    LOG_ERROR << "efficiency job: StChain failed init" << endm;
+    return -1;
+  }
+  mSetupTime += init.RealTime();
+  std::cout << "chain initialized in " << mSetupTime << " s" << std::endl;
+
+  TStopwatch total;
+  TStopwatch timer;
+
+  Long64_t i = 0;
+  while (i < nEvents && mChain->Make() == kStOk) {
+    if (mReportInterval > 0 && i % mReportInterval == 0) {
+      std::cout << "done with event " << i;
+      std::cout << "\tcpu: " << timer.CpuTime() << "\treal: " << timer.RealTime()
+                << "\tratio: " << timer.CpuTime() / timer.RealTime();
+      timer.Start();
+      memory.PrintMem(NULL);
+    }
+    i++;
+    mChain->Clear();
+  }
+  total.Stop();
+  mLoopCpu = total.CpuTime();
+  mLoopReal = total.RealTime();
+
+  TStopwatch finish;
+  mChain->ls(3);
+  mChain->Finish();
+  mFinishTime = finish.RealTime();
+
+  std::cout << "processed " << i << " events in " << mNametag;
+  std::cout << "\tcpu: " << mLoopCpu << "\treal: " << mLoopReal << "\tratio: " << mLoopCpu / mLoopReal;
+  if (mLoopReal > 0)
+    std::cout << "\tevents/s: " << i / mLoopReal;
+  std::cout << std::endl;
+  std::cout << "setup: " << mSetupTime << " s\tevent loop: " << mLoopReal << " s\tfinish: "
+            << mFinishTime << " s" << std::endl;
+  return i;
+}
+
+int StEfficiencyJobMain(int argc, char** argv) {
+  if (argc > 1 && std::string(argv[1]) == "--worker") {
+    if (argc < 3 || argc > 4) {
+      std::cerr << "usage: " << argv[0] << " --worker queueDirectory [idleTimeout]" << std::endl;
+      return 1;
+    }
+    StEfficiencyWorker worker(argv[2]);
+    if (argc > 3)
+      worker.SetIdleTimeout(atof(argv[3]));
+    return worker.Run() < 0 ? 1 : 0;
+  }
+
+  if (argc > 9) {
+    std::cerr << "usage: " << argv[0] << " [nEvents muFileList mcFileList nametag dcaMax"
+              << " fitPoints fitFrac nFiles]" << std::endl;
+    return 1;
+  }
+  // the defaults of efficiency_assessment.cxx
+  Long64_t nEvents = argc > 1 ? (Long64_t) atof(argv[1]) : 1000000000;
+  const char* muFileList = argc > 2 ? argv[2] : "mutest.list";
+  const char* mcFileList = argc > 3 ? argv[3] : "mctest.list";
+  const char* nametag = argc > 4 ? argv[4] : "StEfficiencyAssessor_example";
+  double dcaMax = argc > 5 ? atof(argv[5]) : 3.0;
+  int fitPoints = argc > 6 ? atoi(argv[6]) : 20;
+  double fitFrac = argc > 7 ? atof(argv[7]) : 0.52;
+  int nFiles = argc > 8 ? atoi(argv[8]) : 5;
+
+  StEfficiencyJob job(muFileList, mcFileList, nametag, dcaMax, fitPoints, fitFrac, nFiles);
+  if (!job.Setup())
+    return 1;
+  return job.Run(nEvents) < 0 ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+/* compiled driver for StEfficiencyAssessor
+   builds the chain of efficiency_assessment.cxx (StMuDstMaker,
+   the miniMC chain from the file catalogs and the assessor with
+   its cuts & triggers) and runs the event loop natively
+
+   used by the standalone executable (StRoot/macros/
+   efficiency_assessment_main.cc, built by macros/compile.csh)
+   through StEfficiencyJobMain, and by efficiency_assessment.cxx,
+   so both produce the same output. StEfficiencyWorker runs one
+   job after the other on the same assessor:
+
+     StEfficiencyJob job("mu.list", "mc.list", "tag");
+     if (job.Setup()) {
+       job.Assessor()->SetSparseOutput(true);
+       job.Run();
+     }
+ */
+
+#ifndef STEFFICIENCYJOB__HH
+#define STEFFICIENCYJOB__HH
+
+#include "TObject.h"
+
+#include <string>
+
+class StChain;
+class StMuDstMaker;
+class StEfficiencyAssessor;
+class TChain;
+
+class StEfficiencyJob : public TObject {
+
+public:
+
+  /* the arguments of efficiency_assessment.cxx */
+  StEfficiencyJob(const char* muFileList = "mutest.list",
+                  const char* mcFileList = "mctest.list",
+                  const char* nametag = "StEfficiencyAssessor_example",
+                  double dcaMax = 3.0, int fitPoints = 20,
+                  double fitFrac = 0.52, int nFiles = 5);
+  ~StEfficiencyJob();
+
+  /* builds the chain; false if the miniMC chain is empty.
+     The assessor can be configured between Setup and Run.
+     If assessor is given, it is reused - moved into the new
+     chain, with the job's miniMC chain, output file & cuts -
+     instead of a new one being made. The job does not own a
+     reused assessor, and takes it out of its chain (see
+     StEfficiencyAssessor::UnloadTree) when it is deleted
+   */
+  Bool_t Setup(StEfficiencyAssessor* assessor = 0);
+
+  StEfficiencyAssessor* Assessor() {return mAssessor;}
+  StChain* Chain()                 {return mChain;}
+
+  /* the caller takes over the assessor the job made, which
+     stays alive after the job, for the next Setup
+   */
+  StEfficiencyAssessor* ReleaseAssessor() {mOwnsAssessor = kFALSE; return mAssessor;}
+
+  /* Init, at most nEvents events, Finish - prints timing &
+     memory every mReportInterval events. Returns the number
+     of events processed, -1 if the chain failed to initialize
+   */
+  Long64_t Run(Long64_t nEvents = 1000000000);
+
+  void SetReportInterval(int events) {mReportInterval = events;}
+
+  /* timing of the last Run(), in seconds */
+  Double_t SetupTime() const  {return mSetupTime;}
+  Double_t LoopCpu() const    {return mLoopCpu;}
+  Double_t LoopReal() const   {return mLoopReal;}
+  Double_t FinishTime() const {return mFinishTime;}
+
+private:
+
+  StEfficiencyJob(const StEfficiencyJob&);
+  StEfficiencyJob& operator=(const StEfficiencyJob&);
+
+  std::string mMuFileList;
+  std::string mMcFileList;
+  std::string mNametag;
+  double      mDcaMax;
+  int         mFitPoints;
+  double      mFitFrac;
+  int         mFiles;
+  int         mReportInterval;
+
+  StChain*              mChain;
+  StMuDstMaker*         mMuDstMaker;
+  StEfficiencyAssessor* mAssessor;
+  Bool_t                mOwnsAssessor;
+  TChain*               mMcChain;
+
+  Double_t mSetupTime;
+  Double_t mLoopCpu;
+  Double_t mLoopReal;
+  Double_t mFinishTime;
+
+  ClassDef(StEfficiencyJob, 1)
+};
+
+/* entry point of the standalone executable - argv holds the
+   arguments of efficiency_assessment.cxx, in the same order:
+     nEvents muFileList mcFileList nametag dcaMax fitPoints fitFrac nFiles
+   or, for a long-lived worker taking its jobs from a queue
+   directory (see StEfficiencyWorker):
+     --worker queueDirectory [idleTimeout]
+   returns the process exit code
+ */
+extern "C" int StEfficiencyJobMain(int argc, char** argv);
+
+#endif // STEFFICIENCYJOB__HH
@@ -0,0 +1,362 @@
+/* efficiency table written by StEfficiencyAssessor (see
+   SetEfficiencyOutput) - plain C++, no ROOT, header only,
+   so corrected-spectra code can include it on its own
+
+   the table holds efficiency & uncertainty as floats for
+   every bin of up to three axes, e.g. (cent, pt) or
+   (cent, pt, eta), with axis 0 varying slowest. Bin lookup
+   is constant time: uniform axes use a precomputed inverse
+   width, variable-width axes a uniform grid over the axis
+   at least as fine as its narrowest bin, so each grid cell
+   holds at most one bin edge. Values outside an axis are
+   clamped to its first or last bin
+
+   usage:
+     StEfficiencyTable table;
+     if (table.Read("StEfficiencyAssessor.eff")) {
+       float e = table.Efficiency(centrality, pt);
+       float s = table.Interpolate(centrality, pt);
+       table.Efficiencies(nTracks, cent, pt, nullptr, eff);
+     }
+ */
+
+#ifndef STEFFICIENCYTABLE__HH
+#define STEFFICIENCYTABLE__HH
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+class StEfficiencyTable {
+public:
+
+  static const unsigned kMaxDimension = 3;
+  static const unsigned kNameLength = 16;
+  static const uint32_t kVersion = 1;
+  // finest lookup grid for a variable-width axis
+  static const unsigned kMaxGrid = 1 << 16;
+  // tracks per block in the batch query
+  static const unsigned kBlock = 256;
+
+  struct Axis {
+    std::string name;
+    unsigned nBins;
+    double low;
+    double high;
+    std::vector<double> edges;    // empty for uniform bins
+
+    // lookup
+    double invWidth;              // nBins / (high - low), or of the grid
+    std::vector<unsigned> grid;   // variable bins: bin at each grid cell's low edge
+
+    double Center(unsigned bin) const {
+      if (edges.empty())
+        return low + (bin + 0.5) * (high - low) / nBins;
+      return 0.5 * (edges[bin] + edges[bin + 1]);
+    }
+  };
+
+  StEfficiencyTable() : cells_(0) {}
+
+  /* building a table: add its axes in order (edges holds
+     nBins + 1 values, or nullptr for uniform bins), then
+     the values of every cell
+   */
+  bool AddAxis(std::string name, unsigned nBins, double low, double high, const double* edges = nullptr) {
+    if (axes_.size() >= kMaxDimension || nBins == 0 || !(high > low))
+      return false;
+    Axis axis;
+    axis.name = name.substr(0, kNameLength - 1);
+    axis.nBins = nBins;
+    axis.low = low;
+    axis.high = high;
+    if (edges != nullptr)
+      axis.edges.assign(edges, edges + nBins + 1);
+    axes_.push_back(axis);
+    Prepare();
+    return true;
+  }
+
+  bool SetValues(const std::vector<float>& efficiency, const std::vector<float>& error) {
+    if (efficiency.size() != cells_ || error.size() != cells_)
+      return false;
+    eff_ = efficiency;
+    err_ = error;
+    return true;
+  }
+
+  bool Write(const char* path) const {
+    FILE* out = fopen(path, "wb");
+    if (out == nullptr)
+      return false;
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "STEFFTAB", 8);
+    header.version = kVersion;
+    header.dimension = axes_.size();
+    header.cells = cells_;
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    for (unsigned i = 0; i < axes_.size(); ++i) {
+      AxisRecord record;
+      memset(&record, 0, sizeof(record));
+      strncpy(record.name, axes_[i].name.c_str(), kNameLength - 1);
+      record.nBins = axes_[i].nBins;
+      record.nEdges = axes_[i].edges.size();
+      record.low = axes_[i].low;
+      record.high = axes_[i].high;
+      ok = ok && fwrite(&record, sizeof(record), 1, out) == 1;
+      if (record.nEdges > 0)
+        ok = ok && fwrite(&axes_[i].edges[0], sizeof(double), record.nEdges, out) == record.nEdges;
+    }
+    if (cells_ > 0) {
+      ok = ok && fwrite(&eff_[0], sizeof(float), cells_, out) == cells_;
+      ok = ok && fwrite(&err_[0], sizeof(float), cells_, out) == cells_;
+    }
+    return fclose(out) == 0 && ok;
+  }
+
+  bool Read(const char* path) {
+    axes_.clear();
+    cells_ = 0;
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr)
+      return false;
+    Header header;
+    bool ok = fread(&header, sizeof(header), 1, in) == 1 && memcmp(header.magic, "STEFFTAB", 8) == 0 &&
+              header.version == kVersion && header.dimension <= kMaxDimension;
+    for (unsigned i = 0; ok && i < header.dimension; ++i) {
+      AxisRecord record;
+      ok = fread(&record, sizeof(record), 1, in) == 1 &&
+           (record.nEdges == 0 || record.nEdges == record.nBins + 1);
+      std::vector<double> edges(record.nEdges);
+      if (ok && record.nEdges > 0)
+        ok = fread(&edges[0], sizeof(double), record.nEdges, in) == record.nEdges;
+      record.name[kNameLength - 1] = '\0';
+      ok = ok && AddAxis(record.name, record.nBins, record.low, record.high,
+                         edges.empty() ? nullptr : &edges[0]);
+    }
+    ok = ok && header.cells == cells_;
+    eff_.assign(cells_, 0.0f);
+    err_.assign(cells_, 0.0f);
+    if (ok && cells_ > 0) {
+      ok = fread(&eff_[0], sizeof(float), cells_, in) == cells_ &&
+           fread(&err_[0], sizeof(float), cells_, in) == cells_;
+    }
+    fclose(in);
+    if (!ok) {
+      axes_.clear();
+      cells_ = 0;
+      eff_.clear();
+      err_.clear();
+    }
+    return ok;
+  }
+
+  unsigned Dimension() const              {return axes_.size();}
+  const Axis& GetAxis(unsigned i) const   {return axes_[i];}
+  size_t Cells() const                    {return cells_;}
+  const std::vector<float>& Values() const {return eff_;}
+  const std::vector<float>& Errors() const {return err_;}
+
+  /* true once values are set for every cell - until then
+     every query returns 0
+   */
+  bool Loaded() const {return cells_ > 0 && eff_.size() == cells_ && err_.size() == cells_;}
+
+  /* the bin (from 0) of x on axis i, clamped to the axis */
+  unsigned Bin(unsigned i, double x) const {
+    const Axis& axis = axes_[i];
+    double t = (x - axis.low) * axis.invWidth;
+    if (axis.edges.empty())
+      return Clamp(t, axis.nBins);
+    unsigned bin = axis.grid[Clamp(t, axis.grid.size())];
+    while (bin + 1 < axis.nBins && x >= axis.edges[bin + 1])
+      bin++;
+    return bin;
+  }
+
+  size_t Cell(double x0, double x1 = 0, double x2 = 0) const {
+    double x[kMaxDimension] = {x0, x1, x2};
+    size_t cell = 0;
+    for (unsigned i = 0; i < axes_.size(); ++i)
+      cell = cell * axes_[i].nBins + Bin(i, x[i]);
+    return cell;
+  }
+
+  float Efficiency(double x0, double x1 = 0, double x2 = 0) const {
+    return Loaded() ? eff_[Cell(x0, x1, x2)] : 0.0f;
+  }
+  float Error(double x0, double x1 = 0, double x2 = 0) const {
+    return Loaded() ? err_[Cell(x0, x1, x2)] : 0.0f;
+  }
+
+  /* multilinear interpolation between bin centers - flat
+     beyond the first & last centers of each axis
+   */
+  float Interpolate(double x0, double x1 = 0, double x2 = 0) const {
+    if (!Loaded())
+      return 0.0f;
+    double x[kMaxDimension] = {x0, x1, x2};
+    unsigned lo[kMaxDimension], hi[kMaxDimension];
+    double frac[kMaxDimension];
+    for (unsigned i = 0; i < axes_.size(); ++i)
+      Neighbours(i, x[i], lo[i], hi[i], frac[i]);
+
+    double sum = 0.0;
+    for (unsigned corner = 0; corner < (1u << axes_.size()); ++corner) {
+      double weight = 1.0;
+      size_t cell = 0;
+      for (unsigned i = 0; i < axes_.size(); ++i) {
+        bool upper = corner & (1u << i);
+        weight *= upper ? frac[i] : 1.0 - frac[i];
+        cell = cell * axes_[i].nBins + (upper ? hi[i] : lo[i]);
+      }
+      if (weight != 0.0)
+        sum += weight * eff_[cell];
+    }
+    return sum;
+  }
+
+  /* efficiency of n tracks, with coordinates in x0, x1, x2
+     (nullptr for axes the table does not have). Bins are
+     found one axis at a time over blocks of tracks, in
+     loops simple enough for the compiler to vectorize,
+     then the values are gathered
+   */
+  void Efficiencies(size_t n, const float* x0, const float* x1, const float* x2, float* out) const {
+    if (!Loaded()) {
+      std::fill(out, out + n, 0.0f);
+      return;
+    }
+    const float* x[kMaxDimension] = {x0, x1, x2};
+    uint32_t cells[kBlock];
+    uint32_t bins[kBlock];
+    for (size_t start = 0; start < n; start += kBlock) {
+      unsigned count = std::min<size_t>(kBlock, n - start);
+      std::fill(cells, cells + count, 0);
+      for (unsigned i = 0; i < axes_.size(); ++i) {
+        BinBlock(i, x[i] + start, count, bins);
+        uint32_t stride = axes_[i].nBins;
+        for (unsigned k = 0; k < count; ++k)
+          cells[k] = cells[k] * stride + bins[k];
+      }
+      const float* eff = &eff_[0];
+      for (unsigned k = 0; k < count; ++k)
+        out[start + k] = eff[cells[k]];
+    }
+  }
+
+private:
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t dimension;
+    uint64_t cells;
+  };
+
+  struct AxisRecord {
+    char name[kNameLength];
+    uint32_t nBins;
+    uint32_t nEdges;
+    double low;
+    double high;
+  };
+
+  static unsigned Clamp(double t, unsigned n) {
+    t = t < 0.0 ? 0.0 : t;
+    t = t > n - 1 ? n - 1 : t;
+    return (unsigned) t;
+  }
+
+  void Prepare() {
+    cells_ = 1;
+    for (unsigned i = 0; i < axes_.size(); ++i) {
+      Axis& axis = axes_[i];
+      cells_ *= axis.nBins;
+      axis.grid.clear();
+      if (axis.edges.empty()) {
+        axis.invWidth = axis.nBins / (axis.high - axis.low);
+        continue;
+      }
+      double narrowest = axis.high - axis.low;
+      for (unsigned b = 0; b < axis.nBins; ++b)
+        narrowest = std::min(narrowest, axis.edges[b + 1] - axis.edges[b]);
+      unsigned nGrid = std::min<double>(kMaxGrid, ceil((axis.high - axis.low) / narrowest));
+      nGrid = std::max(nGrid, 1u);
+      axis.invWidth = nGrid / (axis.high - axis.low);
+      axis.grid.resize(nGrid);
+      unsigned bin = 0;
+      for (unsigned g = 0; g < nGrid; ++g) {
+        double edge = axis.low + g / axis.invWidth;
+        while (bin + 1 < axis.nBins && edge >= axis.edges[bin + 1])
+          bin++;
+        axis.grid[g] = bin;
+      }
+    }
+    if (axes_.empty())
+      cells_ = 0;
+  }
+
+  void BinBlock(unsigned i, const float* x, unsigned count, uint32_t* bins) const {
+    const Axis& axis = axes_[i];
+    if (x == nullptr) {
+      std::fill(bins, bins + count, 0);
+      return;
+    }
+    const float low = axis.low;
+    const float invWidth = axis.invWidth;
+    if (axis.edges.empty()) {
+      const float last = axis.nBins - 1;
+      for (unsigned k = 0; k < count; ++k) {
+        float t = (x[k] - low) * invWidth;
+        t = t < 0.0f ? 0.0f : t;
+        t = t > last ? last : t;
+        bins[k] = (uint32_t) t;
+      }
+      return;
+    }
+    // variable bins: the grid, then at most one edge per grid cell
+    const float lastGrid = axis.grid.size() - 1;
+    const unsigned* grid = &axis.grid[0];
+    const double* edges = &axis.edges[0];
+    for (unsigned k = 0; k < count; ++k) {
+      float t = (x[k] - low) * invWidth;
+      t = t < 0.0f ? 0.0f : t;
+      t = t > lastGrid ? lastGrid : t;
+      uint32_t bin = grid[(uint32_t) t];
+      while (bin + 1 < axis.nBins && x[k] >= edges[bin + 1])
+        bin++;
+      bins[k] = bin;
+    }
+  }
+
+  void Neighbours(unsigned i, double x, unsigned& lo, unsigned& hi, double& frac) const {
+    const Axis& axis = axes_[i];
+    unsigned bin = Bin(i, x);
+    double center = axis.Center(bin);
+    lo = hi = bin;
+    frac = 0.0;
+    if (x >= center && bin + 1 < axis.nBins)
+      hi = bin + 1;
+    else if (x < center && bin > 0)
+      lo = bin - 1;
+    if (lo == hi)
+      return;
+    double cLo = axis.Center(lo);
+    double cHi = axis.Center(hi);
+    frac = std::min(std::max((x - cLo) / (cHi - cLo), 0.0), 1.0);
+  }
+
+  std::vector<Axis> axes_;
+  size_t cells_;
+  std::vector<float> eff_;
+  std::vector<float> err_;
+};
+
+#endif // STEFFICIENCYTABLE__HH
@@ -0,0 +1,168 @@
+#include "StEfficiencyWorker.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "StEfficiencyAssessor.hh"
+#include "StEfficiencyJob.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+
+ClassImp(StEfficiencyWorker)
+
+namespace {
+
+  const std::string kJobSuffix = ".job";
+
+  double Now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  std::string Trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+      return "";
+    return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+  }
+
+  bool EndsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+}
+
+StEfficiencyWorker::StEfficiencyWorker(const char* queueDirectory)
+  : mQueue(queueDirectory), mPollInterval(5), mIdleTimeout(600), mAssessor(nullptr),
+    mJobsDone(0), mJobsFailed(0) {}
+
+StEfficiencyWorker::~StEfficiencyWorker() {
+  // every job has taken the assessor out of its chain again
+  delete mAssessor;
+}
+
+Long64_t StEfficiencyWorker::Run() {
+  struct stat st;
+  if (stat(mQueue.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+    LOG_ERROR << "efficiency worker: can not read queue directory " << mQueue << endm;
+    return -1;
+  }
+  LOG_INFO << "efficiency worker: taking jobs from " << mQueue << endm;
+
+  double idleSince = Now();
+  while (!StopRequested()) {
+    std::string job = NextJob();
+    if (job.empty()) {
+      if (mIdleTimeout >= 0 && Now() - idleSince >= mIdleTimeout)
+        break;
+      std::this_thread::sleep_for(std::chrono::duration<double>(mPollInterval));
+      continue;
+    }
+    RunJob(job);
+    idleSince = Now();
+  }
+  LOG_INFO << "efficiency worker: " << mJobsDone << " jobs done, " << mJobsFailed << " failed" << endm;
+  return mJobsDone;
+}
+
+Bool_t StEfficiencyWorker::RunJob(const std::string& jobFile) {
+  // the rename is atomic - a job another worker claimed first is left alone
+  std::string running = jobFile + ".running";
+  if (rename(jobFile.c_str(), running.c_str()) != 0) {
+    LOG_DEBUG << "efficiency worker: " << jobFile << " was claimed by another worker" << endm;
+    return kFALSE;
+  }
+  LOG_INFO << "efficiency worker: starting " << jobFile << endm;
+  double start = Now();
+
+  Long64_t nEvents = 0;
+  StEfficiencyJob* job = ReadJob(running, nEvents);
+  Bool_t ok = job != nullptr && job->Setup(mAssessor);
+  if (ok) {
+    if (mAssessor == nullptr)
+      mAssessor = job->ReleaseAssessor();
+    ok = job->Run(nEvents) >= 0;
+  }
+  // the job's chains go, the assessor stays for the next job
+  delete job;
+
+  std::string finished = jobFile + (ok ? ".done" : ".failed");
+  rename(running.c_str(), finished.c_str());
+  if (ok)
+    mJobsDone++;
+  else
+    mJobsFailed++;
+  LOG_INFO << "efficiency worker: " << jobFile << (ok ? " done" : " failed") << " after "
+           << Now() - start << " s" << endm;
+  return ok;
+}
+
+StEfficiencyJob* StEfficiencyWorker::ReadJob(const std::string& jobFile, Long64_t& nEvents) {
+  std::ifstream in(jobFile.c_str());
+  if (!in.is_open()) {
+    LOG_ERROR << "efficiency worker: can not read " << jobFile << endm;
+    return nullptr;
+  }
+
+  // the defaults of efficiency_assessment.cxx
+  std::map<std::string, std::string> keys;
+  keys["dca"] = "3.0";
+  keys["nhit"] = "20";
+  keys["nhitfrac"] = "0.52";
+  keys["nfiles"] = "5";
+  keys["nevents"] = "1e9";
+  const char* required[] = {"mulist", "mclist", "nametag"};
+
+  std::string line;
+  while (std::getline(in, line)) {
+    line = Trim(line.substr(0, line.find('#')));
+    if (line.empty())
+      continue;
+    size_t equals = line.find('=');
+    std::string key = Trim(line.substr(0, equals));
+    bool known = keys.count(key) || std::find(required, required + 3, key) != required + 3;
+    if (equals == std::string::npos || !known) {
+      LOG_ERROR << "efficiency worker: " << jobFile << ": can not use \"" << line << "\"" << endm;
+      return nullptr;
+    }
+    keys[key] = Trim(line.substr(equals + 1));
+  }
+  for (int i = 0; i < 3; ++i) {
+    if (keys[required[i]].empty()) {
+      LOG_ERROR << "efficiency worker: " << jobFile << " has no " << required[i] << endm;
+      return nullptr;
+    }
+  }
+
+  nEvents = (Long64_t) atof(keys["nevents"].c_str());
+  return new StEfficiencyJob(keys["mulist"].c_str(), keys["mclist"].c_str(), keys["nametag"].c_str(),
+                             atof(keys["dca"].c_str()), atoi(keys["nhit"].c_str()),
+                             atof(keys["nhitfrac"].c_str()), atoi(keys["nfiles"].c_str()));
+}
+
+std::string StEfficiencyWorker::NextJob() const {
+  std::vector<std::string> jobs;
+  DIR* dir = opendir(mQueue.c_str());
+  if (dir == nullptr)
+    return "";
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (EndsWith(name, kJobSuffix))
+      jobs.push_back(name);
+  }
+  closedir(dir);
+  if (jobs.empty())
+    return "";
+  return mQueue + "/" + *std::min_element(jobs.begin(), jobs.end());
+}
+
+Bool_t StEfficiencyWorker::StopRequested() const {
+  struct stat st;
+  return stat((mQueue + "/STOP").c_str(), &st) == 0;
+}
@@ -0,0 +1,96 @@
+/* long-lived worker for StEfficiencyAssessor
+   runs job after job from a local queue directory in one
+   process, so the STAR libraries, the centrality definitions
+   and the histograms of the assessor are set up once, not
+   once per job. Each job is an StEfficiencyJob on the same
+   assessor, which is handed the job's miniMC chain through
+   LoadTree, and releases it (UnloadTree) when the job ends
+
+   a job is a text file <name>.job in the queue directory,
+   with one key = value per line ('#' starts a comment):
+
+     mulist   = /path/to/mu.list      (required)
+     mclist   = /path/to/mc.list      (required)
+     nametag  = /path/to/output       (required, writes output.root)
+     dca      = 3.0
+     nhit     = 20
+     nhitfrac = 0.52
+     nfiles   = 5
+     nevents  = 1e9
+
+   with the defaults of efficiency_assessment.cxx. A worker
+   claims a job by renaming it to <name>.job.running - so any
+   number of workers can share a queue - and renames it to
+   <name>.job.done or <name>.job.failed once it is over. A
+   file named STOP in the queue directory stops every worker
+   after its current job
+
+   run it with the standalone executable:
+     efficiency_assessment --worker /path/to/queue [idleTimeout]
+ */
+
+#ifndef STEFFICIENCYWORKER__HH
+#define STEFFICIENCYWORKER__HH
+
+#include "TObject.h"
+
+#include <string>
+
+class StEfficiencyAssessor;
+class StEfficiencyJob;
+
+class StEfficiencyWorker : public TObject {
+
+public:
+
+  StEfficiencyWorker(const char* queueDirectory = ".");
+  ~StEfficiencyWorker();
+
+  /* how often an empty queue is checked for new jobs, and
+     how long it can stay empty before Run returns - negative
+     waits until a STOP file appears. The defaults are 5 s
+     and 600 s
+   */
+  void SetPollInterval(double seconds) {mPollInterval = seconds;}
+  void SetIdleTimeout(double seconds)  {mIdleTimeout = seconds;}
+
+  /* runs jobs until the queue has been idle for the idle
+     timeout, or a STOP file appears. Returns the number of
+     jobs done, -1 if the queue directory can not be read
+   */
+  Long64_t Run();
+
+  /* claims & runs one job file; false if it failed */
+  Bool_t RunJob(const std::string& jobFile);
+
+  /* the job of a job file, nullptr if the file is not valid */
+  static StEfficiencyJob* ReadJob(const std::string& jobFile, Long64_t& nEvents);
+
+  /* the assessor shared by all jobs - created by the first */
+  StEfficiencyAssessor* Assessor() {return mAssessor;}
+
+  Long64_t JobsDone() const   {return mJobsDone;}
+  Long64_t JobsFailed() const {return mJobsFailed;}
+
+private:
+
+  StEfficiencyWorker(const StEfficiencyWorker&);
+  StEfficiencyWorker& operator=(const StEfficiencyWorker&);
+
+  /* the oldest unclaimed job, by name - empty if there is none */
+  std::string NextJob() const;
+  Bool_t StopRequested() const;
+
+  std::string mQueue;
+  double      mPollInterval;
+  double      mIdleTimeout;
+
+  StEfficiencyAssessor* mAssessor;
+
+  Long64_t mJobsDone;
+  Long64_t mJobsFailed;
+
+  ClassDef(StEfficiencyWorker, 1)
+};
+
+#endif // STEFFICIENCYWORKER__HH
@@ -218,6 +218,41 @@ void StEventCuts::MaskRuns(UInt_t run) {
   mRuns.insert(run);
 }
 
+std::vector<UInt_t> StEventCuts::Counters() const {
+  std::vector<UInt_t> counters;
+  counters.push_back(mNEvents);
+  counters.push_back(mEventsFailed);
+  counters.push_back(mEventsFailedVx);
+  counters.push_back(mEventsFailedVy);
+  counters.push_back(mEventsFailedVz);
+  counters.push_back(mEventsFailedVr);
+  counters.push_back(mEventsFailedRef);
+  counters.push_back(mEventsFailedTriggerTotal);
+  counters.insert(counters.end(), mEventsFailedTrigger.begin(), mEventsFailedTrigger.end());
+  return counters;
+}
+
+Bool_t StEventCuts::RestoreCounters(const std::vector<UInt_t>& counters) {
+  if (counters.size() != 8 + mEventsFailedTrigger.size()) {
+    LOG_ERROR << "event cut counters do not match the triggers in use" << endm;
+    return kFALSE;
+  }
+  mNEvents = counters[0];
+  mEventsFailed = counters[1];
+  mEventsFailedVx = counters[2];
+  mEventsFailedVy = counters[3];
+  mEventsFailedVz = counters[4];
+  mEventsFailedVr = counters[5];
+  mEventsFailedRef = counters[6];
+  mEventsFailedTriggerTotal = counters[7];
+  std::copy(counters.begin() + 8, counters.end(), mEventsFailedTrigger.begin());
+  return kTRUE;
+}
+
+void StEventCuts::ResetCounters() {
+  RestoreCounters(std::vector<UInt_t>(8 + mEventsFailedTrigger.size(), 0));
+}
+
 void StEventCuts::PrintCuts() {
   LOG_INFO << "// ------------------ StEventCuts Cuts ------------------ //" << endm;
   LOG_INFO << endm;
@@ -56,6 +56,18 @@ public:
      Called in Finish() of TStarJetPicoMaker */
   void PrintStats();
   
+  /* the rejection counters, in a flat list - saved in
+     checkpoints, and restored when a job is resumed. The
+     list must come from cuts with the same triggers
+   */
+  std::vector<UInt_t> Counters() const;
+  Bool_t RestoreCounters(const std::vector<UInt_t>& counters);
+  
+  /* zeroes the rejection counters, keeping the cuts - for
+     cuts reused by the next job of a worker
+   */
+  void ResetCounters();
+  
   // access to cuts
   inline Double_t MinVz() const {return mMinVz;}
   inline Double_t MaxVz() const {return mMaxVz;}
@@ -0,0 +1,244 @@
+#include "StEventIndex.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TChainElement.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+  
+  /* on-disk sidecar layout: this header, followed by one
+     8 byte key per tree entry, in entry order. The header
+     is a multiple of 8 bytes so the keys stay aligned when
+     the file is mapped
+   */
+  const char kSidecarMagic[8] = {'S', 'T', 'E', 'V', 'T', 'I', 'D', 'X'};
+  const UInt_t kSidecarVersion = 1;
+  
+  /* key of an entry without an event - never inserted */
+  const ULong64_t kNoEvent = ~0ULL;
+  
+  /* elements read per entry when a count branch is used */
+  const int kMaxElements = 16;
+  
+  struct SidecarHeader {
+    char magic[8];
+    UInt_t version;
+    UInt_t reserved;
+    Long64_t fileSize;
+    Long64_t fileMTime;
+    Long64_t nEntries;
+  };
+  
+  /* sidecars only make sense for files on a posix filesystem */
+  bool StatInput(const char* fileName, struct stat& st) {
+    if (strstr(fileName, "://") != nullptr)
+      return false;
+    return stat(fileName, &st) == 0;
+  }
+}
+
+StEventIndex::StEventIndex(std::string treeName, std::string runLeaf, std::string eventLeaf)
+  : tree_name_(treeName), run_leaf_(runLeaf), event_leaf_(eventLeaf),
+    count_branch_(""), sidecar_dir_(""), use_sidecars_(true), index_(), entries_(0),
+    duplicates_(0), files_from_sidecar_(0) {}
+
+StEventIndex::~StEventIndex() {
+  
+}
+
+void StEventIndex::Clear() {
+  index_.clear();
+  entries_ = 0;
+  duplicates_ = 0;
+  files_from_sidecar_ = 0;
+}
+
+bool StEventIndex::Build(TChain* chain) {
+  Clear();
+  if (chain == nullptr)
+    return false;
+  
+  TObjArray* files = chain->GetListOfFiles();
+  for (int i = 0; i < files->GetEntriesFast(); ++i) {
+    const char* fileName = ((TChainElement*) files->UncheckedAt(i))->GetTitle();
+    Long64_t nEntries = -1;
+    if (use_sidecars_ && (nEntries = ReadSidecar(fileName, entries_)) >= 0)
+      files_from_sidecar_++;
+    else
+      nEntries = IndexFile(fileName, entries_);
+    if (nEntries < 0) {
+      LOG_ERROR << "could not index file: " << fileName << endm;
+      Clear();
+      return false;
+    }
+    entries_ += nEntries;
+  }
+  
+  if (duplicates_ > 0) {
+    LOG_WARN << "event index: " << duplicates_ << " duplicate (run, event) pairs, first occurrence is used" << endm;
+  }
+  LOG_INFO << "event index: " << index_.size() << " events from " << files->GetEntriesFast()
+           << " files (" << files_from_sidecar_ << " from sidecars)" << endm;
+  return true;
+}
+
+Long64_t StEventIndex::Find(int runId, int eventId) const {
+  std::unordered_map<ULong64_t, Long64_t>::const_iterator it = index_.find(Key(runId, eventId));
+  if (it == index_.end())
+    return -1;
+  return it->second;
+}
+
+Long64_t StEventIndex::IndexFile(const char* fileName, Long64_t offset) {
+  TFile* file = TFile::Open(fileName);
+  if (file == nullptr || file->IsZombie()) {
+    delete file;
+    return -1;
+  }
+  TTree* tree = (TTree*) file->Get(tree_name_.c_str());
+  if (tree == nullptr) {
+    LOG_ERROR << "file does not contain tree " << tree_name_ << ": " << fileName << endm;
+    file->Close();
+    delete file;
+    return -1;
+  }
+  
+  // read the two id leaves directly, without building the event object
+  Int_t runId[kMaxElements] = {0};
+  Int_t eventId[kMaxElements] = {0};
+  Int_t count = 1;
+  tree->SetMakeClass(1);
+  tree->SetBranchStatus("*", 0);
+  if (!count_branch_.empty()) {
+    tree->SetBranchStatus(count_branch_.c_str(), 1);
+    tree->SetBranchAddress(count_branch_.c_str(), &count);
+  }
+  tree->SetBranchStatus(run_leaf_.c_str(), 1);
+  tree->SetBranchStatus(event_leaf_.c_str(), 1);
+  if (tree->SetBranchAddress(run_leaf_.c_str(), runId) < 0 ||
+      tree->SetBranchAddress(event_leaf_.c_str(), eventId) < 0) {
+    LOG_ERROR << "could not find leaves " << run_leaf_ << ", " << event_leaf_ << " in " << fileName << endm;
+    file->Close();
+    delete file;
+    return -1;
+  }
+  
+  Long64_t nEntries = tree->GetEntries();
+  std::vector<ULong64_t> keys(nEntries);
+  index_.reserve(index_.size() + nEntries);
+  for (Long64_t i = 0; i < nEntries; ++i) {
+    tree->GetEntry(i);
+    if (count < 1 || count > kMaxElements) {
+      keys[i] = kNoEvent;
+      continue;
+    }
+    keys[i] = Key(runId[0], eventId[0]);
+    Insert(keys[i], offset + i);
+  }
+  
+  file->Close();
+  delete file;
+  
+  if (use_sidecars_)
+    WriteSidecar(fileName, keys);
+  return nEntries;
+}
+
+Long64_t StEventIndex::ReadSidecar(const char* fileName, Long64_t offset) {
+  struct stat input;
+  if (!StatInput(fileName, input))
+    return -1;
+  
+  std::string path = SidecarPath(fileName);
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return -1;
+  struct stat sidecar;
+  if (fstat(fd, &sidecar) != 0 || sidecar.st_size < (off_t) sizeof(SidecarHeader)) {
+    close(fd);
+    return -1;
+  }
+  void* map = mmap(nullptr, sidecar.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return -1;
+  
+  const SidecarHeader* header = (const SidecarHeader*) map;
+  Long64_t nEntries = -1;
+  if (memcmp(header->magic, kSidecarMagic, sizeof(kSidecarMagic)) == 0 &&
+      header->version == kSidecarVersion &&
+      header->fileSize == (Long64_t) input.st_size &&
+      header->fileMTime == (Long64_t) input.st_mtime &&
+      header->nEntries >= 0 &&
+      (Long64_t) sidecar.st_size == (Long64_t) sizeof(SidecarHeader) + header->nEntries * (Long64_t) sizeof(ULong64_t)) {
+    nEntries = header->nEntries;
+    const ULong64_t* keys = (const ULong64_t*) ((const char*) map + sizeof(SidecarHeader));
+    index_.reserve(index_.size() + nEntries);
+    for (Long64_t i = 0; i < nEntries; ++i)
+      if (keys[i] != kNoEvent)
+        Insert(keys[i], offset + i);
+  }
+  else {
+    LOG_INFO << "stale event index sidecar, rebuilding: " << path << endm;
+  }
+  munmap(map, sidecar.st_size);
+  return nEntries;
+}
+
+bool StEventIndex::WriteSidecar(const char* fileName, const std::vector<ULong64_t>& keys) {
+  struct stat input;
+  if (!StatInput(fileName, input))
+    return false;
+  
+  SidecarHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kSidecarMagic, sizeof(kSidecarMagic));
+  header.version = kSidecarVersion;
+  header.fileSize = input.st_size;
+  header.fileMTime = input.st_mtime;
+  header.nEntries = keys.size();
+  
+  // write to a temporary and rename, so concurrent jobs never see a partial sidecar
+  std::string path = SidecarPath(fileName);
+  char pid[32];
+  snprintf(pid, sizeof(pid), ".%d.tmp", (int) getpid());
+  std::string tmp = path + pid;
+  FILE* out = fopen(tmp.c_str(), "wb");
+  if (out == nullptr) {
+    LOG_DEBUG << "can not write event index sidecar: " << path << endm;
+    return false;
+  }
+  bool good = fwrite(&header, sizeof(header), 1, out) == 1;
+  if (good && keys.size())
+    good = fwrite(&keys[0], sizeof(ULong64_t), keys.size(), out) == keys.size();
+  good = (fclose(out) == 0) && good;
+  if (!good || rename(tmp.c_str(), path.c_str()) != 0) {
+    LOG_WARN << "failed to write event index sidecar: " << path << endm;
+    unlink(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+std::string StEventIndex::SidecarPath(const char* fileName) const {
+  std::string name(fileName);
+  if (sidecar_dir_.empty())
+    return name + ".evtidx";
+  size_t slash = name.find_last_of('/');
+  std::string base = slash == std::string::npos ? name : name.substr(slash + 1);
+  return sidecar_dir_ + "/" + base + ".evtidx";
+}
+
+void StEventIndex::Insert(ULong64_t key, Long64_t entry) {
+  if (!index_.insert(std::make_pair(key, entry)).second)
+    duplicates_++;
+}
@@ -0,0 +1,108 @@
+/* internal class for StEfficiencyAssessor
+   maps (runId, eventId) to an entry number in a TChain,
+   built once from the run & event id leaves only, so
+   matching an event costs a single hash lookup instead
+   of a scan through the chain
+ 
+   the ids of each file are cached on disk in a sidecar
+   file (<file>.evtidx, next to the input file or in a
+   separate directory). Sidecars are validated against
+   the size & modification time of the input file, and
+   are memory mapped when read, so a job over a list that
+   has been seen before does not open any input file to
+   build its index
+ */
+
+#ifndef STEVENTINDEX__HH
+#define STEVENTINDEX__HH
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "TChain.h"
+
+class StEventIndex {
+public:
+  
+  /* tree & leaf names default to the StMiniMcTree layout */
+  StEventIndex(std::string treeName = "StMiniMcTree",
+               std::string runLeaf = "mRunId",
+               std::string eventLeaf = "mEventId");
+  ~StEventIndex();
+  
+  /* reads the run & event id of every entry in the chain,
+     one file at a time, from the sidecar if a valid one
+     exists. Returns false if any file could not be read
+   */
+  bool Build(TChain* chain);
+  
+  /* returns the chain entry for (runId, eventId), or -1
+     if the event is not in the chain
+   */
+  Long64_t Find(int runId, int eventId) const;
+  
+  void Clear();
+  
+  Long64_t Entries() const {return entries_;}
+  unsigned Duplicates() const {return duplicates_;}
+  
+  /* sidecars are written next to the input files by
+     default. If a directory is given they are read from
+     and written to that directory instead, named by the
+     input file's base name
+   */
+  void SetSidecarDirectory(std::string dir) {sidecar_dir_ = dir;}
+  std::string SidecarDirectory() const     {return sidecar_dir_;}
+  
+  /* sidecars can be turned off entirely - the index is
+     then always rebuilt from the input files
+   */
+  void UseSidecars(bool flag) {use_sidecars_ = flag;}
+  bool UseSidecars() const    {return use_sidecars_;}
+  
+  /* for id leaves that are members of a split TClonesArray
+     (MuEvent in a MuDst), the array's count branch. The ids
+     of the first element are used, entries with an empty
+     array are not indexed
+   */
+  void SetCountBranch(std::string branch) {count_branch_ = branch;}
+  std::string CountBranch() const        {return count_branch_;}
+  
+  static ULong64_t Key(int runId, int eventId) {
+    return ((ULong64_t) (UInt_t) runId << 32) | (UInt_t) eventId;
+  }
+  
+private:
+  
+  /* adds all entries in one file to the index, with entry
+     numbers shifted by offset. Returns the number of entries
+     in the file, or -1 on failure
+   */
+  Long64_t IndexFile(const char* fileName, Long64_t offset);
+  
+  /* same as IndexFile, but from a sidecar - returns -1 if
+     there is no valid sidecar for the file
+   */
+  Long64_t ReadSidecar(const char* fileName, Long64_t offset);
+  bool WriteSidecar(const char* fileName, const std::vector<ULong64_t>& keys);
+  std::string SidecarPath(const char* fileName) const;
+  
+  void Insert(ULong64_t key, Long64_t entry);
+  
+  std::string tree_name_;
+  std::string run_leaf_;
+  std::string event_leaf_;
+  std::string count_branch_;
+  
+  std::string sidecar_dir_;
+  bool use_sidecars_;
+  
+  std::unordered_map<ULong64_t, Long64_t> index_;
+  
+  Long64_t entries_;
+  unsigned duplicates_;
+  unsigned files_from_sidecar_;
+};
+
+#endif // STEVENTINDEX__HH
@@ -0,0 +1,267 @@
+#include "StFileCatalog.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "TChain.h"
+#include "TFile.h"
+#include "TTree.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <sys/stat.h>
+
+ClassImp(StFileCatalog)
+
+namespace {
+
+  const char* kCatalogVersion = "StFileCatalog-1";
+
+  /* cached metadata of one file, as read from the catalog */
+  struct Record {
+    Long64_t size, mtime, entries;
+    Int_t minRun, maxRun, minEvent, maxEvent;
+  };
+
+  /* only files on a posix filesystem can be validated */
+  bool StatFile(const std::string& path, Long64_t& size, Long64_t& mtime) {
+    struct stat st;
+    if (path.find("://") != std::string::npos || stat(path.c_str(), &st) != 0)
+      return false;
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+  }
+}
+
+StFileCatalog::StFileCatalog(std::string treeName, std::string runLeaf, std::string eventLeaf)
+  : mTreeName(treeName), mRunLeaf(runLeaf), mEventLeaf(eventLeaf), mScanned(0) {}
+
+StFileCatalog::~StFileCatalog() {
+
+}
+
+std::string StFileCatalog::CatalogPath(const char* fileList) {
+  return std::string(fileList) + ".catalog";
+}
+
+Bool_t StFileCatalog::Load(const char* fileList, Int_t maxFiles) {
+  mFiles.clear();
+  mSize.clear();
+  mMTime.clear();
+  mEntries.clear();
+  mMinRun.clear();
+  mMaxRun.clear();
+  mMinEvent.clear();
+  mMaxEvent.clear();
+  mScanned = 0;
+
+  std::ifstream list(fileList);
+  if (!list.good()) {
+    LOG_ERROR << "could not open file list: " << fileList << endm;
+    return kFALSE;
+  }
+  std::string line;
+  bool limited = false;
+  while (std::getline(list, line)) {
+    if (line.empty())
+      continue;
+    if (maxFiles > 0 && (Int_t) mFiles.size() == maxFiles) {
+      limited = true;
+      break;
+    }
+    mFiles.push_back(line);
+  }
+
+  size_t n = mFiles.size();
+  mSize.assign(n, -1);
+  mMTime.assign(n, -1);
+  mEntries.assign(n, -1);
+  mMinRun.assign(n, 0);
+  mMaxRun.assign(n, 0);
+  mMinEvent.assign(n, 0);
+  mMaxEvent.assign(n, 0);
+
+  std::string path = CatalogPath(fileList);
+  ReadCatalog(path);
+  for (size_t i = 0; i < n; ++i) {
+    if (mEntries[i] >= 0)
+      continue;
+    if (!ScanFile(i)) {
+      LOG_WARN << "file catalog: could not read " << mFiles[i] << endm;
+      continue;
+    }
+    mScanned++;
+  }
+  if (mScanned > 0 && !limited)
+    WriteCatalog(path);
+
+  LOG_INFO << "file catalog: " << n << " files, " << Entries() << " entries in " << fileList
+           << " (" << mScanned << " files opened)" << endm;
+  return kTRUE;
+}
+
+Bool_t StFileCatalog::ReadCatalog(const std::string& path) {
+  std::ifstream in(path.c_str());
+  if (!in.good())
+    return kFALSE;
+  std::string version, tree;
+  std::string line;
+  if (!std::getline(in, line))
+    return kFALSE;
+  std::istringstream header(line);
+  header >> version >> tree;
+  if (version != kCatalogVersion || tree != mTreeName)
+    return kFALSE;
+
+  std::map<std::string, Record> records;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string file;
+    Record record;
+    if (fields >> file >> record.size >> record.mtime >> record.entries >> record.minRun
+               >> record.maxRun >> record.minEvent >> record.maxEvent)
+      records[file] = record;
+  }
+
+  // a record is used only if the file has not changed since
+  for (size_t i = 0; i < mFiles.size(); ++i) {
+    std::map<std::string, Record>::const_iterator it = records.find(mFiles[i]);
+    Long64_t size, mtime;
+    if (it == records.end() || !StatFile(mFiles[i], size, mtime) ||
+        size != it->second.size || mtime != it->second.mtime)
+      continue;
+    mSize[i] = size;
+    mMTime[i] = mtime;
+    mEntries[i] = it->second.entries;
+    mMinRun[i] = it->second.minRun;
+    mMaxRun[i] = it->second.maxRun;
+    mMinEvent[i] = it->second.minEvent;
+    mMaxEvent[i] = it->second.maxEvent;
+  }
+  return kTRUE;
+}
+
+Bool_t StFileCatalog::WriteCatalog(const std::string& path) const {
+  // written to a temporary file first, so a concurrent job never
+  // reads a partial catalog
+  std::ostringstream tmp;
+  tmp << path << ".tmp" << this;
+  std::ofstream out(tmp.str().c_str());
+  if (!out.good()) {
+    LOG_WARN << "file catalog: could not write " << path << endm;
+    return kFALSE;
+  }
+  out << kCatalogVersion << " " << mTreeName << "\n";
+  for (size_t i = 0; i < mFiles.size(); ++i) {
+    if (mEntries[i] < 0 || mSize[i] < 0)
+      continue;
+    out << mFiles[i] << " " << mSize[i] << " " << mMTime[i] << " " << mEntries[i] << " "
+        << mMinRun[i] << " " << mMaxRun[i] << " " << mMinEvent[i] << " " << mMaxEvent[i] << "\n";
+  }
+  out.close();
+  if (out.fail() || rename(tmp.str().c_str(), path.c_str()) != 0) {
+    remove(tmp.str().c_str());
+    LOG_WARN << "file catalog: could not write " << path << endm;
+    return kFALSE;
+  }
+  return kTRUE;
+}
+
+Bool_t StFileCatalog::ScanFile(Int_t i) {
+  StatFile(mFiles[i], mSize[i], mMTime[i]);
+  TFile* file = TFile::Open(mFiles[i].c_str());
+  if (file == nullptr || file->IsZombie()) {
+    delete file;
+    return kFALSE;
+  }
+  TTree* tree = (TTree*) file->Get(mTreeName.c_str());
+  if (tree == nullptr) {
+    file->Close();
+    delete file;
+    return kFALSE;
+  }
+  mEntries[i] = tree->GetEntries();
+  if (mEntries[i] > 0) {
+    mMinRun[i] = (Int_t) tree->GetMinimum(mRunLeaf.c_str());
+    mMaxRun[i] = (Int_t) tree->GetMaximum(mRunLeaf.c_str());
+    mMinEvent[i] = (Int_t) tree->GetMinimum(mEventLeaf.c_str());
+    mMaxEvent[i] = (Int_t) tree->GetMaximum(mEventLeaf.c_str());
+  }
+  file->Close();
+  delete file;
+  return kTRUE;
+}
+
+Bool_t StFileCatalog::Overlaps(Int_t i, const StFileCatalog& other, Int_t j) const {
+  // files without metadata are always kept
+  if (mEntries[i] < 0 || other.mEntries[j] < 0)
+    return kTRUE;
+  if (mEntries[i] == 0 || other.mEntries[j] == 0)
+    return kFALSE;
+  return mMinRun[i] <= other.mMaxRun[j] && other.mMinRun[j] <= mMaxRun[i] &&
+         mMinEvent[i] <= other.mMaxEvent[j] && other.mMinEvent[j] <= mMaxEvent[i];
+}
+
+Int_t StFileCatalog::Restrict(const StFileCatalog& other) {
+  Int_t dropped = 0;
+  size_t kept = 0;
+  for (size_t i = 0; i < mFiles.size(); ++i) {
+    bool overlap = false;
+    for (Int_t j = 0; j < other.Files() && !overlap; ++j)
+      overlap = Overlaps(i, other, j);
+    if (!overlap) {
+      LOG_DEBUG << "file catalog: no partner events, dropping " << mFiles[i] << endm;
+      dropped++;
+      continue;
+    }
+    mFiles[kept] = mFiles[i];
+    mSize[kept] = mSize[i];
+    mMTime[kept] = mMTime[i];
+    mEntries[kept] = mEntries[i];
+    mMinRun[kept] = mMinRun[i];
+    mMaxRun[kept] = mMaxRun[i];
+    mMinEvent[kept] = mMinEvent[i];
+    mMaxEvent[kept] = mMaxEvent[i];
+    kept++;
+  }
+  mFiles.resize(kept);
+  mSize.resize(kept);
+  mMTime.resize(kept);
+  mEntries.resize(kept);
+  mMinRun.resize(kept);
+  mMaxRun.resize(kept);
+  mMinEvent.resize(kept);
+  mMaxEvent.resize(kept);
+
+  if (dropped > 0) {
+    LOG_INFO << "file catalog: dropped " << dropped << " files whose run & event ranges match no "
+             << other.mTreeName << " file" << endm;
+  }
+  return dropped;
+}
+
+Long64_t StFileCatalog::Entries() const {
+  Long64_t total = 0;
+  for (size_t i = 0; i < mEntries.size(); ++i)
+    if (mEntries[i] > 0)
+      total += mEntries[i];
+  return total;
+}
+
+void StFileCatalog::AddTo(TChain* chain) const {
+  // files without metadata are left for the chain to count
+  for (size_t i = 0; i < mFiles.size(); ++i) {
+    if (mEntries[i] >= 0)
+      chain->Add(mFiles[i].c_str(), mEntries[i]);
+    else
+      chain->Add(mFiles[i].c_str());
+  }
+}
+
+TChain* StFileCatalog::MakeChain() const {
+  TChain* chain = new TChain(mTreeName.c_str());
+  AddTo(chain);
+  return chain;
+}
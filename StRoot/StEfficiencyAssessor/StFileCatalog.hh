@@ -0,0 +1,92 @@
+/* helper class for StEfficiencyAssessor
+   per-file metadata for a file list: the number of tree
+   entries and the run & event id ranges of each file.
+   The catalog is cached next to the list (<list>.catalog),
+   and validated against the size & modification time of
+   each file, so a chain built from it knows its entries
+   without opening any file
+
+   files whose run & event ranges can not overlap any file
+   of a second catalog (the muDsts for a miniMC list) can
+   be dropped before the chain is built
+
+   see StRoot/macros/efficiency_assessment.cxx
+ */
+
+#ifndef STFILECATALOG__HH
+#define STFILECATALOG__HH
+
+#include "TObject.h"
+
+#include <string>
+#include <vector>
+
+class TChain;
+
+class StFileCatalog : public TObject {
+
+public:
+
+  /* tree & leaf names default to the StMiniMcTree layout */
+  StFileCatalog(std::string treeName = "StMiniMcTree",
+                std::string runLeaf = "mRunId",
+                std::string eventLeaf = "mEventId");
+  ~StFileCatalog();
+
+  /* reads the file list, takes each file's metadata from
+     the cached catalog if it is still valid, and opens the
+     file otherwise. The catalog is rewritten if anything
+     changed. maxFiles > 0 keeps only the first maxFiles
+     files of the list (the catalog is then not rewritten,
+     so it keeps the files left out). Returns false if the
+     list can not be read
+   */
+  Bool_t Load(const char* fileList, Int_t maxFiles = 0);
+
+  /* drops every file whose run & event id ranges do not
+     overlap with any file in other. Returns the number of
+     files dropped
+   */
+  Int_t Restrict(const StFileCatalog& other);
+
+  /* adds all files to chain with their entry counts, so the
+     chain does not open them to count entries
+   */
+  void AddTo(TChain* chain) const;
+  TChain* MakeChain() const;
+
+  Int_t Files() const {return mFiles.size();}
+  Long64_t Entries() const;
+  std::string File(Int_t i) const    {return mFiles[i];}
+  Long64_t Entries(Int_t i) const    {return mEntries[i];}
+
+  /* the catalog file of a list */
+  static std::string CatalogPath(const char* fileList);
+
+private:
+
+  Bool_t ReadCatalog(const std::string& path);
+  Bool_t WriteCatalog(const std::string& path) const;
+  Bool_t ScanFile(Int_t i);
+  Bool_t Overlaps(Int_t i, const StFileCatalog& other, Int_t j) const;
+
+  std::string mTreeName;
+  std::string mRunLeaf;
+  std::string mEventLeaf;
+
+  // one element per file, in list order
+  std::vector<std::string> mFiles;
+  std::vector<Long64_t>    mSize;
+  std::vector<Long64_t>    mMTime;
+  std::vector<Long64_t>    mEntries;
+  std::vector<Int_t>       mMinRun;
+  std::vector<Int_t>       mMaxRun;
+  std::vector<Int_t>       mMinEvent;
+  std::vector<Int_t>       mMaxEvent;
+
+  Int_t mScanned;
+
+  ClassDef(StFileCatalog, 1)
+};
+
+#endif // STFILECATALOG__HH
@@ -0,0 +1,243 @@
+#include "StFillBenchmark.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "StAxisDef.hh"
+#include "StDenseHistogram.hh"
+#include "StEfficiencyAssessor.hh"
+#include "StObservableGroup.hh"
+
+#include "TH3D.h"
+#include "TMath.h"
+#include "TRandom3.h"
+#include "TStopwatch.h"
+
+#include <math.h>
+#include <vector>
+
+ClassImp(StFillBenchmark)
+
+namespace {
+
+  // the track cuts of Make, at their defaults
+  const double kMaxDca = 3.0;
+  const int kMinFit = 20;
+  const double kMinFitFrac = 0.52;
+
+  struct Track {
+    int cent;
+    float pt, dca, eta, phi;
+    int fitPts, nPossiblePts;
+  };
+
+  // the reco & recocut histograms of DefineHistograms: third axis, and
+  // whether pt is the 100 bin extended axis instead of the default one
+  struct Definition {
+    const char* name;
+    bool ptExt;
+    int n;
+    double low, high;
+  };
+
+  const Definition kHistograms[] = {
+    {"reconhit", false, 50, 0, 50},
+    {"recodca", false, 50, 0, 3.0},
+    {"recoeta", false, 50, -1, 1},
+    {"recophi", false, 50, -TMath::Pi(), TMath::Pi()},
+    {"reconhitposs", false, 50, 0, 50},
+    {"recofitfrac", false, 50, 0, 1},
+    {"recodcascale", false, 50, 0, 3.0},
+    {"reconhitcut", false, 50, 0, 50},
+    {"recodcacut", false, 50, 0, 3.0},
+    {"recoetacut", false, 50, -1, 1},
+    {"recophicut", false, 50, -TMath::Pi(), TMath::Pi()},
+    {"reconhitposscut", false, 50, 0, 50},
+    {"recocutfitfrac", false, 50, 0, 1},
+    {"recocutdcaext", true, 50, 0, 3.0}
+  };
+  const int kNHistograms = sizeof(kHistograms) / sizeof(kHistograms[0]);
+
+  // binned as the assessor books them by default - the variable pt
+  // axis makes every histogram variable-width
+  std::vector<TH3D*> Create(const char* suffix) {
+    axisDef pt = StEfficiencyAssessor::DefaultPtAxis();
+    std::vector<TH3D*> hists;
+    for (int i = 0; i < kNHistograms; ++i) {
+      const Definition& def = kHistograms[i];
+      std::vector<axisDef> axes;
+      axes.push_back(StEfficiencyAssessor::DefaultCentralityAxis());
+      axes.push_back(def.ptExt ? axisDef(100, pt.low, pt.high) : pt);
+      axes.push_back(axisDef(def.n, def.low, def.high));
+      hists.push_back((TH3D*) axisDef::NewHistogram((std::string(def.name) + suffix).c_str(), "", axes));
+    }
+    return hists;
+  }
+
+  // the matched-track loop of Make, for either histogram type
+  template <class H>
+  Long64_t FillTracks(const std::vector<Track>& tracks, H* const* h) {
+    Long64_t fills = 0;
+    for (size_t i = 0; i < tracks.size(); ++i) {
+      const Track& t = tracks[i];
+      double cent = t.cent;
+      double pt = t.pt;
+      double fitFrac = (double) (t.fitPts + 1) / (t.nPossiblePts + 1);
+      h[0]->Fill(cent, pt, (double) (t.fitPts + 1));
+      h[1]->Fill(cent, pt, (double) t.dca);
+      h[2]->Fill(cent, pt, (double) t.eta);
+      h[3]->Fill(cent, pt, (double) t.phi);
+      h[4]->Fill(cent, pt, (double) (t.nPossiblePts + 1));
+      h[5]->Fill(cent, pt, fitFrac);
+      fills += 6;
+      if (fabs(t.eta) > 1.0 || fitFrac < kMinFitFrac)
+        continue;
+      h[6]->Fill(cent, pt, (double) t.dca);
+      fills++;
+      if (t.dca > kMaxDca || t.fitPts < kMinFit)
+        continue;
+      h[7]->Fill(cent, pt, (double) (t.fitPts + 1));
+      h[8]->Fill(cent, pt, (double) t.dca);
+      h[9]->Fill(cent, pt, (double) t.eta);
+      h[10]->Fill(cent, pt, (double) t.phi);
+      h[11]->Fill(cent, pt, (double) (t.nPossiblePts + 1));
+      h[12]->Fill(cent, pt, fitFrac);
+      h[13]->Fill(cent, pt, (double) t.dca);
+      fills += 7;
+    }
+    return fills;
+  }
+
+  // the same loop with the fills of Make: a group per family, and
+  // the histograms outside the groups filled on their own
+  Long64_t FillTracks(const std::vector<Track>& tracks, StObservableGroup* reco, StDenseHistogram* dcaScale,
+                      StObservableGroup* recoCut, StDenseHistogram* dcaExt) {
+    Long64_t fills = 0;
+    double values[6];
+    for (size_t i = 0; i < tracks.size(); ++i) {
+      const Track& t = tracks[i];
+      double cent = t.cent;
+      double pt = t.pt;
+      double fitFrac = (double) (t.fitPts + 1) / (t.nPossiblePts + 1);
+      values[0] = t.fitPts + 1;
+      values[1] = t.dca;
+      values[2] = t.eta;
+      values[3] = t.phi;
+      values[4] = t.nPossiblePts + 1;
+      values[5] = fitFrac;
+      reco->Fill(cent, pt, values);
+      fills += 6;
+      if (fabs(t.eta) > 1.0 || fitFrac < kMinFitFrac)
+        continue;
+      dcaScale->Fill(cent, pt, (double) t.dca);
+      fills++;
+      if (t.dca > kMaxDca || t.fitPts < kMinFit)
+        continue;
+      recoCut->Fill(cent, pt, values);
+      dcaExt->Fill(cent, pt, (double) t.dca);
+      fills += 7;
+    }
+    return fills;
+  }
+
+  bool Identical(const TH1* a, const TH1* b) {
+    if (a->GetNcells() != b->GetNcells() || a->GetEntries() != b->GetEntries())
+      return false;
+    for (int cell = 0; cell < a->GetNcells(); ++cell)
+      if (a->GetBinContent(cell) != b->GetBinContent(cell))
+        return false;
+    Double_t statsA[TH1::kNstat] = {0};
+    Double_t statsB[TH1::kNstat] = {0};
+    a->GetStats(statsA);
+    b->GetStats(statsB);
+    for (int i = 0; i < TH1::kNstat; ++i)
+      if (statsA[i] != statsB[i])
+        return false;
+    return true;
+  }
+}
+
+StFillBenchmark::StFillBenchmark()
+  : mFills(0), mTh3Seconds(0), mDenseSeconds(0), mGroupSeconds(0), mFlushSeconds(0) {}
+
+StFillBenchmark::~StFillBenchmark() {
+
+}
+
+Bool_t StFillBenchmark::Run(Int_t nEvents, Int_t nTracks, UInt_t seed) {
+  TRandom3 random(seed);
+  std::vector<Track> tracks;
+  tracks.reserve((size_t) nEvents * nTracks);
+  for (Int_t event = 0; event < nEvents; ++event) {
+    int cent = random.Integer(9);
+    for (Int_t i = 0; i < nTracks; ++i) {
+      Track t;
+      t.cent = cent;
+      t.pt = random.Exp(0.6);
+      t.dca = random.Exp(0.8);
+      t.eta = random.Uniform(-1.2, 1.2);
+      t.phi = random.Uniform(-TMath::Pi(), TMath::Pi());
+      t.nPossiblePts = 20 + random.Integer(26);
+      t.fitPts = TMath::Max(5, t.nPossiblePts - (int) random.Integer(20));
+      tracks.push_back(t);
+    }
+  }
+
+  std::vector<TH3D*> direct = Create("_th3");
+  std::vector<TH3D*> targets = Create("_dense");
+  std::vector<StDenseHistogram*> dense;
+  for (int i = 0; i < kNHistograms; ++i)
+    dense.push_back(new StDenseHistogram(targets[i]));
+  std::vector<TH3D*> grouped = Create("_group");
+  StObservableGroup reco(&grouped[0], 6);
+  StDenseHistogram dcaScale(grouped[6]);
+  StObservableGroup recoCut(&grouped[7], 6);
+  StDenseHistogram dcaExt(grouped[13]);
+
+  TStopwatch timer;
+  mFills = FillTracks(tracks, &direct[0]);
+  mTh3Seconds = timer.RealTime();
+
+  timer.Start();
+  FillTracks(tracks, &dense[0]);
+  mDenseSeconds = timer.RealTime();
+
+  timer.Start();
+  FillTracks(tracks, &reco, &dcaScale, &recoCut, &dcaExt);
+  mGroupSeconds = timer.RealTime();
+
+  timer.Start();
+  for (int i = 0; i < kNHistograms; ++i)
+    dense[i]->Flush();
+  mFlushSeconds = timer.RealTime();
+  reco.Flush();
+  dcaScale.Flush();
+  recoCut.Flush();
+  dcaExt.Flush();
+
+  Bool_t identical = kTRUE;
+  for (int i = 0; i < kNHistograms; ++i) {
+    if (!Identical(direct[i], targets[i]) || !Identical(direct[i], grouped[i])) {
+      LOG_ERROR << "fill benchmark: " << kHistograms[i].name << " differs between the fills" << endm;
+      identical = kFALSE;
+    }
+  }
+
+  LOG_INFO << "fill benchmark: " << nEvents << " events, " << tracks.size() << " tracks, " << mFills
+           << " fills into " << kNHistograms << " histograms" << endm;
+  LOG_INFO << "fill benchmark: TH3D::Fill          " << mTh3Seconds << " s, "
+           << mFills / mTh3Seconds / 1e6 << " M fills/s" << endm;
+  LOG_INFO << "fill benchmark: StDenseHistogram    " << mDenseSeconds << " s, "
+           << mFills / mDenseSeconds / 1e6 << " M fills/s (" << mTh3Seconds / mDenseSeconds
+           << "x), flush " << mFlushSeconds << " s" << endm;
+  LOG_INFO << "fill benchmark: StObservableGroup   " << mGroupSeconds << " s, "
+           << mFills / mGroupSeconds / 1e6 << " M fills/s (" << mTh3Seconds / mGroupSeconds << "x)" << endm;
+  LOG_INFO << "fill benchmark: histograms " << (identical ? "identical" : "DIFFER") << endm;
+
+  for (int i = 0; i < kNHistograms; ++i) {
+    delete direct[i];
+    delete dense[i];
+    delete targets[i];
+    delete grouped[i];
+  }
+  return identical;
+}
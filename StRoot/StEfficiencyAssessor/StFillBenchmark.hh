@@ -0,0 +1,56 @@
+/* offline tool for StEfficiencyAssessor
+   measures the fill throughput of the matched-track
+   histograms of Make - the seven reco and seven recocut
+   TH3Ds, filled with the cuts of Make - through TH3D::Fill,
+   through one StDenseHistogram per histogram, and through
+   StObservableGroups of the histograms that share their
+   (cent, pt) fill, as Make does, on the same generated
+   events, and checks that the flushed histograms are
+   identical to the directly filled ones. The histograms
+   take the assessor's default axes, so pt is binned by
+   variable edges
+
+   the events are generated once, up front: a centrality bin
+   and nTracks matched tracks per event, with exponential pt
+   and dca, flat eta & phi and a spread of fit points, so
+   that roughly half the tracks pass the cuts
+
+   see StRoot/macros/benchmark_fill.cxx
+ */
+
+#ifndef STFILLBENCHMARK__HH
+#define STFILLBENCHMARK__HH
+
+#include "TObject.h"
+
+class StFillBenchmark : public TObject {
+
+public:
+
+  StFillBenchmark();
+  ~StFillBenchmark();
+
+  /* generates the events and runs both fills - false if
+     the histograms differ
+   */
+  Bool_t Run(Int_t nEvents = 2000, Int_t nTracks = 400, UInt_t seed = 4357);
+
+  /* results of the last Run() */
+  Long64_t Fills() const        {return mFills;}
+  Double_t Th3Seconds() const   {return mTh3Seconds;}
+  Double_t DenseSeconds() const {return mDenseSeconds;}
+  Double_t GroupSeconds() const {return mGroupSeconds;}
+  Double_t FlushSeconds() const {return mFlushSeconds;}
+
+private:
+
+  Long64_t mFills;
+  Double_t mTh3Seconds;
+  Double_t mDenseSeconds;
+  Double_t mGroupSeconds;
+  Double_t mFlushSeconds;
+
+  ClassDef(StFillBenchmark, 1)
+};
+
+#endif // STFILLBENCHMARK__HH
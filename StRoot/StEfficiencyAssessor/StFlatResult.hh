@@ -0,0 +1,203 @@
+/* reader for the flat result file of StEfficiencyAssessor
+   (see StFlatResultWriter and SetFlatOutput) - plain C++,
+   no ROOT, header only. The file is memory mapped and used
+   in place, with nothing parsed or copied:
+
+     Header                     at 0
+     Axis  [nAxes]              the axisDefs of the job
+     Block [nBlocks]            one per histogram
+     bin arrays                 doubles, 64-byte aligned
+
+   bin arrays hold every cell of a histogram, under- and
+   overflow included, in ROOT's global bin order:
+       cell = x + (nx + 2) * (y + (ny + 2) * z)
+   Edge arrays are only stored for variable-width axes.
+   Files are written in the byte order of the machine that
+   wrote them, and Open refuses any other
+
+   usage:
+     StFlatResult result;
+     if (result.Open("StEfficiencyAssessor.flat")) {
+       const StFlatResult::Block* reco = result.Find("recotracks");
+       double n = result.Content(*reco, 3, 5);
+     }
+ */
+
+#ifndef STFLATRESULT__HH
+#define STFLATRESULT__HH
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+class StFlatResult {
+public:
+
+  static const uint32_t kVersion = 1;
+  static const uint32_t kNameLength = 48;
+  static const uint32_t kAlignment = 64;
+  static const uint32_t kByteOrder = 0x01020304;
+
+  struct Header {
+    char magic[8];          // "STFLAT\0\0"
+    uint32_t version;
+    uint32_t byteOrder;     // kByteOrder as written
+    uint32_t nAxes;
+    uint32_t nBlocks;
+    uint64_t axesOffset;
+    uint64_t blocksOffset;
+    uint64_t fileSize;
+  };
+
+  struct Axis {
+    char name[kNameLength];
+    uint32_t nBins;
+    uint32_t reserved;
+    double low;
+    double high;
+    uint64_t edgesOffset;   // 0 for uniform bins
+  };
+
+  struct Block {
+    char name[kNameLength];
+    uint32_t dimension;
+    uint32_t reserved;
+    uint32_t nBins[3];      // 1 for the unused axes
+    uint32_t padding;
+    double low[3];
+    double high[3];
+    uint64_t edgesOffset[3];
+    double entries;
+    uint64_t nCells;
+    uint64_t contentsOffset;
+    uint64_t sumw2Offset;   // 0 if the histogram has no sum of weights squared
+  };
+
+  static void Magic(char* magic) {
+    memset(magic, 0, 8);
+    memcpy(magic, "STFLAT", 6);
+  }
+
+  StFlatResult() : data_(nullptr), size_(0) {}
+  ~StFlatResult() {Close();}
+
+  bool Open(const char* path) {
+    Close();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header)) {
+      close(fd);
+      return false;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+      return false;
+    data_ = (const char*) data;
+    size_ = st.st_size;
+
+    char magic[8];
+    Magic(magic);
+    const Header& header = GetHeader();
+    if (memcmp(header.magic, magic, 8) != 0 || header.version != kVersion ||
+        header.byteOrder != kByteOrder || header.fileSize != size_ ||
+        header.axesOffset + header.nAxes * sizeof(Axis) > size_ ||
+        header.blocksOffset + header.nBlocks * sizeof(Block) > size_) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  void Close() {
+    if (data_ != nullptr)
+      munmap((void*) data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  bool IsOpen() const {return data_ != nullptr;}
+
+  const Header& GetHeader() const {return *(const Header*) data_;}
+
+  unsigned Axes() const             {return GetHeader().nAxes;}
+  const Axis& GetAxis(unsigned i) const {
+    return ((const Axis*) (data_ + GetHeader().axesOffset))[i];
+  }
+  unsigned Blocks() const           {return GetHeader().nBlocks;}
+  const Block& GetBlock(unsigned i) const {
+    return ((const Block*) (data_ + GetHeader().blocksOffset))[i];
+  }
+
+  /* nullptr if there is no axis (histogram) of that name */
+  const Axis* FindAxis(const char* name) const {
+    for (unsigned i = 0; i < Axes(); ++i)
+      if (strncmp(GetAxis(i).name, name, kNameLength) == 0)
+        return &GetAxis(i);
+    return nullptr;
+  }
+  const Block* Find(const char* name) const {
+    for (unsigned i = 0; i < Blocks(); ++i)
+      if (strncmp(GetBlock(i).name, name, kNameLength) == 0)
+        return &GetBlock(i);
+    return nullptr;
+  }
+
+  const double* Contents(const Block& block) const {return Array(block.contentsOffset);}
+  const double* Sumw2(const Block& block) const    {return Array(block.sumw2Offset);}
+  const double* Edges(const Block& block, unsigned axis) const {return Array(block.edgesOffset[axis]);}
+  const double* Edges(const Axis& axis) const      {return Array(axis.edgesOffset);}
+
+  /* the cell of bin (x, y, z) - bins count from 1, as in ROOT */
+  static uint64_t Cell(const Block& block, unsigned x, unsigned y = 0, unsigned z = 0) {
+    return x + (uint64_t) (block.nBins[0] + 2) * (y + (uint64_t) (block.nBins[1] + 2) * z);
+  }
+
+  double Content(const Block& block, unsigned x, unsigned y = 0, unsigned z = 0) const {
+    return Contents(block)[Cell(block, x, y, z)];
+  }
+
+  double Error(const Block& block, unsigned x, unsigned y = 0, unsigned z = 0) const {
+    uint64_t cell = Cell(block, x, y, z);
+    const double* sumw2 = Sumw2(block);
+    return sqrt(sumw2 != nullptr ? sumw2[cell] : fabs(Contents(block)[cell]));
+  }
+
+  /* the bin of value on one axis of block: 0 below the
+     axis, nBins + 1 at or above its upper edge
+   */
+  unsigned FindBin(const Block& block, unsigned axis, double value) const {
+    unsigned n = block.nBins[axis];
+    const double* edges = Edges(block, axis);
+    if (edges != nullptr)
+      return std::upper_bound(edges, edges + n + 1, value) - edges;
+    if (value < block.low[axis])
+      return 0;
+    if (value >= block.high[axis])
+      return n + 1;
+    unsigned bin = 1 + (unsigned) ((value - block.low[axis]) * n / (block.high[axis] - block.low[axis]));
+    return std::min(bin, n);
+  }
+
+private:
+
+  StFlatResult(const StFlatResult&);
+  StFlatResult& operator=(const StFlatResult&);
+
+  const double* Array(uint64_t offset) const {
+    return offset != 0 ? (const double*) (data_ + offset) : nullptr;
+  }
+
+  const char* data_;
+  size_t size_;
+};
+
+#endif // STFLATRESULT__HH
@@ -0,0 +1,152 @@
+#include "StFlatResultWriter.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "TH1.h"
+
+#include <cstdio>
+
+namespace {
+
+  uint64_t Align(uint64_t offset) {
+    return (offset + StFlatResult::kAlignment - 1) / StFlatResult::kAlignment * StFlatResult::kAlignment;
+  }
+
+  void SetName(char* dest, const std::string& name) {
+    if (name.size() >= StFlatResult::kNameLength)
+      LOG_WARN << "flat output: name " << name << " truncated" << endm;
+    memset(dest, 0, StFlatResult::kNameLength);
+    strncpy(dest, name.c_str(), StFlatResult::kNameLength - 1);
+  }
+
+  /* a bin or edge array, and where it goes in the file */
+  struct Array {
+    uint64_t offset;
+    std::vector<double> values;
+  };
+
+  uint64_t Place(std::vector<Array>& arrays, uint64_t& cursor, const std::vector<double>& values) {
+    Array array;
+    array.offset = cursor;
+    array.values = values;
+    arrays.push_back(array);
+    cursor = Align(cursor + values.size() * sizeof(double));
+    return array.offset;
+  }
+
+  std::vector<double> Edges(const TAxis* axis) {
+    std::vector<double> edges;
+    if (axis->GetXbins()->GetSize() == 0)
+      return edges;
+    for (Int_t i = 1; i <= axis->GetNbins() + 1; ++i)
+      edges.push_back(axis->GetBinLowEdge(i));
+    return edges;
+  }
+}
+
+StFlatResultWriter::StFlatResultWriter() {
+
+}
+
+StFlatResultWriter::~StFlatResultWriter() {
+
+}
+
+void StFlatResultWriter::AddAxis(std::string name, unsigned nBins, double low, double high, const double* edges) {
+  AxisDef axis;
+  memset(&axis.record, 0, sizeof(axis.record));
+  SetName(axis.record.name, name);
+  axis.record.nBins = nBins;
+  axis.record.low = low;
+  axis.record.high = high;
+  if (edges != nullptr)
+    axis.edges.assign(edges, edges + nBins + 1);
+  axes_.push_back(axis);
+}
+
+void StFlatResultWriter::Add(const TH1* hist) {
+  if (hist != nullptr)
+    hists_.push_back(hist);
+}
+
+void StFlatResultWriter::Clear() {
+  axes_.clear();
+  hists_.clear();
+}
+
+long long StFlatResultWriter::Write(const std::string& path) const {
+  StFlatResult::Header header;
+  memset(&header, 0, sizeof(header));
+  StFlatResult::Magic(header.magic);
+  header.version = StFlatResult::kVersion;
+  header.byteOrder = StFlatResult::kByteOrder;
+  header.nAxes = axes_.size();
+  header.nBlocks = hists_.size();
+  header.axesOffset = Align(sizeof(header));
+  header.blocksOffset = Align(header.axesOffset + axes_.size() * sizeof(StFlatResult::Axis));
+  uint64_t cursor = Align(header.blocksOffset + hists_.size() * sizeof(StFlatResult::Block));
+
+  // lay out every array first, then copy all of it into one buffer
+  std::vector<Array> arrays;
+  std::vector<StFlatResult::Axis> axes;
+  for (size_t i = 0; i < axes_.size(); ++i) {
+    axes.push_back(axes_[i].record);
+    if (!axes_[i].edges.empty())
+      axes.back().edgesOffset = Place(arrays, cursor, axes_[i].edges);
+  }
+
+  std::vector<StFlatResult::Block> blocks(hists_.size());
+  for (size_t i = 0; i < hists_.size(); ++i) {
+    const TH1* hist = hists_[i];
+    StFlatResult::Block& block = blocks[i];
+    memset(&block, 0, sizeof(block));
+    SetName(block.name, hist->GetName());
+    block.dimension = hist->GetDimension();
+    const TAxis* histAxes[3] = {hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis()};
+    for (int axis = 0; axis < 3; ++axis) {
+      block.nBins[axis] = histAxes[axis]->GetNbins();
+      block.low[axis] = histAxes[axis]->GetXmin();
+      block.high[axis] = histAxes[axis]->GetXmax();
+      std::vector<double> edges = Edges(histAxes[axis]);
+      if (!edges.empty())
+        block.edgesOffset[axis] = Place(arrays, cursor, edges);
+    }
+    block.entries = hist->GetEntries();
+    block.nCells = hist->GetNcells();
+
+    std::vector<double> contents(block.nCells);
+    for (uint64_t cell = 0; cell < block.nCells; ++cell)
+      contents[cell] = hist->GetBinContent(cell);
+    block.contentsOffset = Place(arrays, cursor, contents);
+    if (hist->GetSumw2N() > 0) {
+      const TArrayD* sumw2 = hist->GetSumw2();
+      block.sumw2Offset = Place(arrays, cursor, std::vector<double>(sumw2->GetArray(), sumw2->GetArray() + block.nCells));
+    }
+  }
+  header.fileSize = cursor;
+
+  std::vector<char> buffer(cursor, 0);
+  memcpy(&buffer[0], &header, sizeof(header));
+  if (!axes.empty())
+    memcpy(&buffer[header.axesOffset], &axes[0], axes.size() * sizeof(StFlatResult::Axis));
+  if (!blocks.empty())
+    memcpy(&buffer[header.blocksOffset], &blocks[0], blocks.size() * sizeof(StFlatResult::Block));
+  for (size_t i = 0; i < arrays.size(); ++i) {
+    if (!arrays[i].values.empty())
+      memcpy(&buffer[arrays[i].offset], &arrays[i].values[0], arrays[i].values.size() * sizeof(double));
+  }
+
+  std::string tmp = path + ".tmp";
+  FILE* out = fopen(tmp.c_str(), "wb");
+  bool ok = out != nullptr && fwrite(&buffer[0], 1, buffer.size(), out) == buffer.size();
+  if (out != nullptr)
+    ok = fclose(out) == 0 && ok;
+  if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    LOG_ERROR << "flat output: could not write " << path << endm;
+    remove(tmp.c_str());
+    return -1;
+  }
+  LOG_INFO << "flat output: " << blocks.size() << " histograms, " << buffer.size() << " bytes written to "
+           << path << endm;
+  return buffer.size();
+}
@@ -0,0 +1,49 @@
+/* internal class for StEfficiencyAssessor
+   writes the flat, memory-mappable copy of the assessor
+   output: the axis definitions of the job and the bin
+   arrays of every histogram, laid out as described in
+   StFlatResult.hh, which is all a reader needs
+
+   the file is written to <path>.tmp and renamed once
+   complete, so a reader never maps a partial file
+ */
+
+#ifndef STFLATRESULTWRITER__HH
+#define STFLATRESULTWRITER__HH
+
+#include "StFlatResult.hh"
+
+#include <string>
+#include <vector>
+
+class TH1;
+
+class StFlatResultWriter {
+public:
+
+  StFlatResultWriter();
+  ~StFlatResultWriter();
+
+  /* a uniform (edges == nullptr) or variable width axis */
+  void AddAxis(std::string name, unsigned nBins, double low, double high,
+               const double* edges = nullptr);
+
+  /* the writer does not own hist */
+  void Add(const TH1* hist);
+  void Clear();
+
+  /* returns the number of bytes written, -1 on error */
+  long long Write(const std::string& path) const;
+
+private:
+
+  struct AxisDef {
+    StFlatResult::Axis record;
+    std::vector<double> edges;
+  };
+
+  std::vector<AxisDef> axes_;
+  std::vector<const TH1*> hists_;
+};
+
+#endif // STFLATRESULTWRITER__HH
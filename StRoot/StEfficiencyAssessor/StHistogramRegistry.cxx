@@ -0,0 +1,264 @@
+#include "StHistogramRegistry.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "TH3D.h"
+
+#include <algorithm>
+
+StHistogramRegistry::StHistogramRegistry() : cube_memory_(0) {
+
+}
+
+StHistogramRegistry::~StHistogramRegistry() {
+  Delete();
+}
+
+void StHistogramRegistry::Define(std::string name, std::string title, std::string family, Stage stage, Axis x) {
+  Define(name, title, family, stage, std::vector<Axis>(1, x));
+}
+
+void StHistogramRegistry::Define(std::string name, std::string title, std::string family, Stage stage,
+                                 Axis x, Axis y) {
+  std::vector<Axis> axes(1, x);
+  axes.push_back(y);
+  Define(name, title, family, stage, axes);
+}
+
+void StHistogramRegistry::Define(std::string name, std::string title, std::string family, Stage stage,
+                                 Axis x, Axis y, Axis z) {
+  std::vector<Axis> axes(1, x);
+  axes.push_back(y);
+  axes.push_back(z);
+  Define(name, title, family, stage, axes);
+}
+
+void StHistogramRegistry::Define(std::string name, std::string title, std::string family, Stage stage,
+                                 const std::vector<Axis>& axes) {
+  if (axes.empty()) {
+    LOG_ERROR << "histogram registry: " << name << " has no axes - dropped" << endm;
+    return;
+  }
+  for (size_t i = 0; i < definitions_.size(); ++i) {
+    if (definitions_[i].name == name) {
+      LOG_ERROR << "histogram registry: " << name << " is defined twice - the second definition is dropped" << endm;
+      return;
+    }
+  }
+  Definition def;
+  def.name = name;
+  def.title = title;
+  def.family = family;
+  def.stage = stage;
+  def.axes = axes;
+  definitions_.push_back(def);
+}
+
+const char* StHistogramRegistry::VariableName(Variable v) {
+  static const char* names[kNVariables] = {"cent", "lumi", "vz", "refmult", "grefmult", "mctracks",
+                                           "recotracks", "pt", "nhit", "dca", "eta", "phi", "nhitposs",
+                                           "fitfrac"};
+  return v < kNVariables ? names[v] : "";
+}
+
+void StHistogramRegistry::EnableFamily(std::string family, bool flag) {
+  if (flag)
+    disabled_.erase(family);
+  else
+    disabled_.insert(family);
+}
+
+void StHistogramRegistry::Book() {
+  std::vector<Definition> enabled;
+  std::set<std::string> families;
+  for (size_t i = 0; i < definitions_.size(); ++i) {
+    families.insert(definitions_[i].family);
+    if (FamilyEnabled(definitions_[i].family))
+      enabled.push_back(definitions_[i]);
+  }
+  for (std::set<std::string>::const_iterator it = disabled_.begin(); it != disabled_.end(); ++it) {
+    if (families.count(*it) == 0)
+      LOG_WARN << "histogram registry: disabled family " << *it << " has no histograms" << endm;
+  }
+
+  if (!booked_.empty() && enabled == booked_) {
+    Reset();
+    SetCubeLimits();
+    return;
+  }
+
+  Delete();
+  booked_ = enabled;
+
+  size_t maxCube = 0;
+  for (size_t i = 0; i < booked_.size(); ++i) {
+    const Definition& def = booked_[i];
+    const std::vector<Axis>& a = def.axes;
+    if (a.size() > 3) {
+      // the title holds the cube title & one title per axis, as a TH1 title does
+      std::vector<std::string> titles;
+      std::string::size_type begin = 0;
+      for (;;) {
+        std::string::size_type end = def.title.find(';', begin);
+        titles.push_back(def.title.substr(begin, end == std::string::npos ? end : end - begin));
+        if (end == std::string::npos)
+          break;
+        begin = end + 1;
+      }
+      titles.resize(a.size() + 1);
+      CubeFill fill;
+      fill.cube = new StDifferentialCube(def.name.c_str(), titles[0].c_str());
+      for (size_t k = 0; k < a.size(); ++k) {
+        fill.cube->AddAxis(VariableName(a[k].variable), titles[k + 1], a[k].binning);
+        fill.variables.push_back(a[k].variable);
+      }
+      cubes_[def.stage].push_back(fill);
+      cube_list_.push_back(fill.cube);
+      cube_defs_.push_back(i);
+      maxCube = std::max(maxCube, a.size());
+      continue;
+    }
+    // kept out of the current directory, so closing a file does not delete them
+    std::vector<axisDef> binning;
+    for (size_t k = 0; k < a.size(); ++k)
+      binning.push_back(a[k].binning);
+    histograms_.push_back(axisDef::NewHistogram(def.name.c_str(), def.title.c_str(), binning));
+    histogram_defs_.push_back(i);
+  }
+  coordinates_.assign(maxCube, 0.0);
+  SetCubeLimits();
+
+  // TH3Ds of one stage with the same x & y are filled as a group
+  std::vector<bool> assigned(histograms_.size(), false);
+  size_t maxGroup = 0;
+  for (size_t i = 0; i < histograms_.size(); ++i) {
+    if (assigned[i])
+      continue;
+    const Definition& def = booked_[histogram_defs_[i]];
+    std::vector<size_t> members(1, i);
+    for (size_t j = i + 1; def.axes.size() == 3 && j < histograms_.size(); ++j) {
+      const Definition& other = booked_[histogram_defs_[j]];
+      if (!assigned[j] && other.axes.size() == 3 && other.stage == def.stage &&
+          other.axes[0] == def.axes[0] && other.axes[1] == def.axes[1])
+        members.push_back(j);
+    }
+
+    if (members.size() == 1) {
+      DenseFill fill;
+      fill.hist = new StDenseHistogram(histograms_[i]);
+      fill.dim = def.axes.size();
+      for (size_t k = 0; k < def.axes.size(); ++k)
+        fill.variables[k] = def.axes[k].variable;
+      dense_[def.stage].push_back(fill);
+      assigned[i] = true;
+      continue;
+    }
+
+    std::vector<TH3D*> targets;
+    GroupFill fill;
+    fill.x = def.axes[0].variable;
+    fill.y = def.axes[1].variable;
+    for (size_t k = 0; k < members.size(); ++k) {
+      assigned[members[k]] = true;
+      targets.push_back((TH3D*) histograms_[members[k]]);
+      fill.z.push_back(booked_[histogram_defs_[members[k]]].axes[2].variable);
+    }
+    fill.group = new StObservableGroup(&targets[0], targets.size());
+    groups_[def.stage].push_back(fill);
+    maxGroup = std::max(maxGroup, members.size());
+  }
+  z_.assign(maxGroup, 0.0);
+
+  LOG_INFO << "histogram registry: " << histograms_.size() << " histograms booked, "
+           << Bytes() / (1024 * 1024) << " MB of fill counters" << endm;
+  if (!cube_list_.empty()) {
+    if (cube_memory_ > 0)
+      LOG_INFO << "histogram registry: " << cube_list_.size() << " differential cubes booked, limited to "
+               << cube_memory_ / (1024 * 1024) << " MB" << endm;
+    else
+      LOG_INFO << "histogram registry: " << cube_list_.size() << " differential cubes booked, unlimited" << endm;
+  }
+}
+
+void StHistogramRegistry::SetCubeLimits() {
+  for (size_t i = 0; i < cube_list_.size(); ++i)
+    cube_list_[i]->SetMemoryLimit(cube_memory_ / (Long64_t) cube_list_.size());
+}
+
+void StHistogramRegistry::Flush() {
+  for (int stage = 0; stage < kNStages; ++stage) {
+    for (size_t i = 0; i < dense_[stage].size(); ++i)
+      dense_[stage][i].hist->Flush();
+    for (size_t i = 0; i < groups_[stage].size(); ++i)
+      groups_[stage][i].group->Flush();
+  }
+}
+
+void StHistogramRegistry::Sync() {
+  for (int stage = 0; stage < kNStages; ++stage) {
+    for (size_t i = 0; i < dense_[stage].size(); ++i)
+      dense_[stage][i].hist->Sync();
+    for (size_t i = 0; i < groups_[stage].size(); ++i)
+      groups_[stage][i].group->Sync();
+  }
+}
+
+void StHistogramRegistry::Reset() {
+  for (int stage = 0; stage < kNStages; ++stage) {
+    for (size_t i = 0; i < dense_[stage].size(); ++i)
+      dense_[stage][i].hist->Reset();
+    for (size_t i = 0; i < groups_[stage].size(); ++i)
+      groups_[stage][i].group->Reset();
+  }
+  for (size_t i = 0; i < histograms_.size(); ++i)
+    histograms_[i]->Reset();
+  for (size_t i = 0; i < cube_list_.size(); ++i)
+    cube_list_[i]->Reset();
+}
+
+void StHistogramRegistry::Delete() {
+  for (int stage = 0; stage < kNStages; ++stage) {
+    for (size_t i = 0; i < dense_[stage].size(); ++i)
+      delete dense_[stage][i].hist;
+    for (size_t i = 0; i < groups_[stage].size(); ++i)
+      delete groups_[stage][i].group;
+    dense_[stage].clear();
+    groups_[stage].clear();
+    cubes_[stage].clear();
+  }
+  for (size_t i = 0; i < histograms_.size(); ++i)
+    delete histograms_[i];
+  for (size_t i = 0; i < cube_list_.size(); ++i)
+    delete cube_list_[i];
+  histograms_.clear();
+  histogram_defs_.clear();
+  cube_list_.clear();
+  cube_defs_.clear();
+  booked_.clear();
+}
+
+TH1* StHistogramRegistry::Get(std::string name) const {
+  for (size_t i = 0; i < histograms_.size(); ++i) {
+    if (booked_[histogram_defs_[i]].name == name)
+      return histograms_[i];
+  }
+  return nullptr;
+}
+
+size_t StHistogramRegistry::Bytes() const {
+  size_t bytes = 0;
+  for (int stage = 0; stage < kNStages; ++stage) {
+    for (size_t i = 0; i < dense_[stage].size(); ++i)
+      bytes += dense_[stage][i].hist->Bytes();
+    for (size_t i = 0; i < groups_[stage].size(); ++i)
+      bytes += groups_[stage][i].group->Bytes();
+  }
+  return bytes;
+}
+
+size_t StHistogramRegistry::CubeBytes() const {
+  size_t bytes = 0;
+  for (size_t i = 0; i < cube_list_.size(); ++i)
+    bytes += cube_list_[i]->Bytes();
+  return bytes;
+}
@@ -0,0 +1,231 @@
+/* internal class for StEfficiencyAssessor
+   the histograms of the event loop, declared in one table:
+   each has a name & title, a family (event, mc, reco,
+   recocut or data - its directory in the family layout),
+   the stage of Make it is filled at, and per axis the
+   variable it is filled with & its binning. Make collects
+   the variables of an event or track into one array, and
+   Fill(stage, values) fills every histogram of that stage
+
+   Book() creates the histograms of the enabled families -
+   a TH1D, TH2D or TH3D by the number of axes, binned by
+   their axisDefs (see axisDef::NewHistogram) - detached from
+   any directory and owned by the registry. The TH3Ds of a
+   stage that share their x & y variables & binning are
+   filled together through an StObservableGroup, everything
+   else through its own StDenseHistogram. Disabled families
+   are not booked, and take neither memory nor fill time
+
+   a definition with more than three axes is booked as an
+   StDifferentialCube instead, named after its variables;
+   SetCubeMemory() caps the memory all cubes may take
+ */
+
+#ifndef STHISTOGRAMREGISTRY__HH
+#define STHISTOGRAMREGISTRY__HH
+
+#include "StAxisDef.hh"
+#include "StDenseHistogram.hh"
+#include "StObservableGroup.hh"
+#include "StDifferentialCube.hh"
+
+#include <set>
+#include <string>
+#include <vector>
+
+class TH1;
+
+class StHistogramRegistry {
+public:
+
+  /* what an axis is filled with - Make sets all variables of a
+     stage before filling it
+   */
+  enum Variable {kCentrality, kLumi, kVz, kRefMult, kGRefMult, kMcTracks, kRecoTracks,
+                 kPt, kNhit, kDca, kEta, kPhi, kNhitPoss, kFitFrac, kNVariables};
+
+  /* the name of a cube axis filled with v */
+  static const char* VariableName(Variable v);
+
+  /* where in Make a histogram is filled
+       kEvent:          every event passing the event cuts
+       kMcTrack:        every primary MC track
+       kRecoTrack:      every primary matched track
+       kRecoTrackScale: matched tracks passing the eta & fit fraction cuts
+       kRecoTrackCut:   matched tracks passing all track cuts
+       kTrackCounts:    once per event, after the track loops
+       kDataTrackScale: muDst tracks passing all cuts but dca
+       kDataTrackCut:   muDst tracks passing all track cuts
+   */
+  enum Stage {kEvent, kMcTrack, kRecoTrack, kRecoTrackScale, kRecoTrackCut,
+              kTrackCounts, kDataTrackScale, kDataTrackCut, kNStages};
+
+  struct Axis {
+    Variable variable;
+    axisDef binning;
+
+    Axis(Variable v, unsigned n, double l, double h)
+      : variable(v), binning(n, l, h) {}
+    Axis(Variable v, const axisDef& b)
+      : variable(v), binning(b) {}
+
+    bool operator==(const Axis& rhs) const {
+      return variable == rhs.variable && binning == rhs.binning;
+    }
+  };
+
+  struct Definition {
+    std::string name;
+    std::string title;
+    std::string family;
+    Stage stage;
+    std::vector<Axis> axes;
+
+    bool operator==(const Definition& rhs) const {
+      return name == rhs.name && title == rhs.title && family == rhs.family &&
+             stage == rhs.stage && axes == rhs.axes;
+    }
+  };
+
+  StHistogramRegistry();
+  ~StHistogramRegistry();
+
+  /* one histogram per call, written in the order declared */
+  void Define(std::string name, std::string title, std::string family, Stage stage, Axis x);
+  void Define(std::string name, std::string title, std::string family, Stage stage, Axis x, Axis y);
+  void Define(std::string name, std::string title, std::string family, Stage stage, Axis x, Axis y, Axis z);
+  void Define(std::string name, std::string title, std::string family, Stage stage, const std::vector<Axis>& axes);
+
+  /* drops the definitions - the booked histograms stay until
+     the next Book()
+   */
+  void ClearDefinitions() {definitions_.clear();}
+
+  /* all families are enabled by default */
+  void EnableFamily(std::string family, bool flag);
+  bool FamilyEnabled(std::string family) const {return disabled_.count(family) == 0;}
+
+  /* the memory all cubes together may allocate, split evenly
+     between them - 0 is unlimited
+   */
+  void SetCubeMemory(Long64_t bytes) {cube_memory_ = bytes;}
+  Long64_t CubeMemory() const        {return cube_memory_;}
+
+  /* books the enabled definitions. If they are the ones booked
+     last time, the histograms are only reset - a worker's jobs
+     with the same binning keep theirs
+   */
+  void Book();
+
+  /* whether anything is filled at stage - Make skips the loops
+     nothing is filled in
+   */
+  bool Active(Stage stage) const {
+    return !dense_[stage].empty() || !groups_[stage].empty() || !cubes_[stage].empty();
+  }
+
+  /* values holds every Variable, indexed by Variable */
+  inline void Fill(Stage stage, const double* values) {
+    const std::vector<DenseFill>& dense = dense_[stage];
+    for (size_t i = 0; i < dense.size(); ++i) {
+      const DenseFill& fill = dense[i];
+      switch (fill.dim) {
+        case 1:
+          fill.hist->Fill(values[fill.variables[0]]);
+          break;
+        case 2:
+          fill.hist->Fill(values[fill.variables[0]], values[fill.variables[1]]);
+          break;
+        default:
+          fill.hist->Fill(values[fill.variables[0]], values[fill.variables[1]], values[fill.variables[2]]);
+      }
+    }
+    const std::vector<GroupFill>& groups = groups_[stage];
+    for (size_t i = 0; i < groups.size(); ++i) {
+      const GroupFill& fill = groups[i];
+      for (size_t j = 0; j < fill.z.size(); ++j)
+        z_[j] = values[fill.z[j]];
+      fill.group->Fill(values[fill.x], values[fill.y], &z_[0]);
+    }
+    const std::vector<CubeFill>& cubes = cubes_[stage];
+    for (size_t i = 0; i < cubes.size(); ++i) {
+      const CubeFill& fill = cubes[i];
+      for (size_t j = 0; j < fill.variables.size(); ++j)
+        coordinates_[j] = values[fill.variables[j]];
+      fill.cube->Fill(&coordinates_[0]);
+    }
+  }
+
+  /* adds everything filled since the last flush to the histograms */
+  void Flush();
+
+  /* continues the fill statistics from those of the histograms -
+     after they were restored from a checkpoint
+   */
+  void Sync();
+
+  /* deletes every booked histogram */
+  void Delete();
+
+  /* the booked histograms, in the order of their definitions */
+  unsigned Size() const                     {return histograms_.size();}
+  TH1* Histogram(unsigned i) const          {return histograms_[i];}
+  const std::string& Family(unsigned i) const {return booked_[histogram_defs_[i]].family;}
+
+  /* the booked cubes, in the order of their definitions */
+  unsigned Cubes() const                          {return cube_list_.size();}
+  StDifferentialCube* Cube(unsigned i) const      {return cube_list_[i];}
+  const std::string& CubeFamily(unsigned i) const {return booked_[cube_defs_[i]].family;}
+
+  /* nullptr if name is not booked */
+  TH1* Get(std::string name) const;
+
+  /* memory held by the fill counters of the histograms, and
+     by the cubes
+   */
+  size_t Bytes() const;
+  size_t CubeBytes() const;
+
+private:
+
+  StHistogramRegistry(const StHistogramRegistry&);
+  StHistogramRegistry& operator=(const StHistogramRegistry&);
+
+  struct DenseFill {
+    StDenseHistogram* hist;
+    int dim;
+    Variable variables[3];
+  };
+
+  struct GroupFill {
+    StObservableGroup* group;
+    Variable x;
+    Variable y;
+    std::vector<Variable> z;
+  };
+
+  struct CubeFill {
+    StDifferentialCube* cube;
+    std::vector<Variable> variables;
+  };
+
+  void Reset();
+  void SetCubeLimits();
+
+  std::vector<Definition> definitions_;
+  std::set<std::string> disabled_;
+
+  std::vector<Definition> booked_;
+  std::vector<TH1*> histograms_;
+  std::vector<size_t> histogram_defs_;     // index in booked_
+  std::vector<StDifferentialCube*> cube_list_;
+  std::vector<size_t> cube_defs_;
+  Long64_t cube_memory_;
+  std::vector<DenseFill> dense_[kNStages];
+  std::vector<GroupFill> groups_[kNStages];
+  std::vector<CubeFill> cubes_[kNStages];
+  std::vector<double> z_;           // the z values of a group fill
+  std::vector<double> coordinates_; // the coordinates of a cube fill
+};
+
+#endif // STHISTOGRAMREGISTRY__HH
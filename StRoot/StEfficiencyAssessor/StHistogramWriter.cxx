@@ -0,0 +1,133 @@
+#include "StHistogramWriter.hh"
+#include "StSparseHistogram.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "RVersion.h"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TObject.h"
+
+#include <chrono>
+
+namespace {
+
+  const Int_t kZlib = 1;
+  const Int_t kLZMA = 2;
+  const Int_t kLZ4  = 4;
+  const Int_t kZSTD = 5;
+}
+
+StHistogramWriter::StHistogramWriter()
+  : compression_(-1), sparse_(false), write_time_(0), bytes_in_(0),
+    bytes_out_(0), sparse_objects_(0) {}
+
+StHistogramWriter::~StHistogramWriter() {
+
+}
+
+Int_t StHistogramWriter::ScratchCompression() {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+  return 100 * kLZ4 + 4;
+#else
+  return 100 * kZlib + 1;
+#endif
+}
+
+Int_t StHistogramWriter::ArchiveCompression() {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,20,0)
+  return 100 * kZSTD + 5;
+#else
+  return 100 * kLZMA + 7;
+#endif
+}
+
+void StHistogramWriter::Add(TObject* obj, std::string dir) {
+  if (obj == nullptr)
+    return;
+  Entry entry;
+  entry.object = obj;
+  entry.dir = dir;
+  objects_.push_back(entry);
+}
+
+void StHistogramWriter::Clear() {
+  objects_.clear();
+}
+
+Int_t StHistogramWriter::EffectiveCompression(Int_t settings) {
+  Int_t algorithm = settings / 100;
+  Int_t level = settings % 100;
+  // the global default and ROOT's old algorithm are written as zlib,
+  // as is anything this ROOT can not compress
+  bool supported = algorithm == kZlib || algorithm == kLZMA;
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+  supported = supported || algorithm == kLZ4;
+#endif
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,20,0)
+  supported = supported || algorithm == kZSTD;
+#endif
+  if (!supported) {
+    if (algorithm != 0 && algorithm != 3)
+      LOG_WARN << "histogram writer: compression algorithm " << algorithm
+               << " not available, using zlib" << endm;
+    algorithm = kZlib;
+  }
+  return 100 * algorithm + level;
+}
+
+Long64_t StHistogramWriter::Write(TDirectory* top) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  write_time_ = 0;
+  bytes_in_ = 0;
+  bytes_out_ = 0;
+  sparse_objects_ = 0;
+
+  TFile* file = top != nullptr ? top->GetFile() : nullptr;
+  if (file == nullptr || !file->IsWritable()) {
+    LOG_ERROR << "histogram writer: output is not a writable file" << endm;
+    return -1;
+  }
+  // by default, the settings of the file. TKey takes them from the
+  // file, so they are set for the duration of the write
+  Int_t fileSettings = file->GetCompressionSettings();
+  Int_t settings = EffectiveCompression(compression_ < 0 ? fileSettings : compression_);
+  file->SetCompressionSettings(settings);
+
+  bool ok = true;
+  for (size_t i = 0; i < objects_.size(); ++i) {
+    TObject* obj = objects_[i].object;
+    StSparseHistogram* sparse = nullptr;
+    if (sparse_ && obj->InheritsFrom(TH1::Class())) {
+      sparse = new StSparseHistogram(*(TH1*) obj);
+      sparse_objects_++;
+    }
+    TObject* written = sparse != nullptr ? sparse : obj;
+
+    TDirectory* dir = top;
+    if (!objects_[i].dir.empty()) {
+      dir = top->GetDirectory(objects_[i].dir.c_str());
+      if (dir == nullptr)
+        dir = top->mkdir(objects_[i].dir.c_str());
+    }
+    // as TDirectoryFile::WriteTObject does it, keeping the sizes
+    TKey* key = new TKey(written, written->GetName(), TBuffer::kInitialSize, dir);
+    file->SumBuffer(key->GetObjlen());
+    bytes_in_ += key->GetObjlen();
+    bytes_out_ += key->GetNbytes();
+    key->WriteFile(0);
+    if (file->TestBit(TFile::kWriteError)) {
+      LOG_ERROR << "histogram writer: write error for " << obj->GetName() << endm;
+      ok = false;
+    }
+    delete sparse;
+  }
+  file->SetCompressionSettings(fileSettings);
+
+  write_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  LOG_INFO << "histogram writer: " << objects_.size() << " objects (" << sparse_objects_ << " sparse), " << bytes_in_
+           << " -> " << bytes_out_ << " bytes (compression " << settings << ") in " << write_time_ << " s" << endm;
+  return ok ? bytes_out_ : -1;
+}
@@ -0,0 +1,94 @@
+/* internal class for StEfficiencyAssessor
+   writes the output histograms of a job into a TFile, in
+   the order they were added, with a chosen compression
+   algorithm & level (ROOT 6 adds LZ4 & ZSTD to zlib &
+   LZMA), into one directory per family if asked to
+
+   each object is streamed & compressed by the public TKey
+   constructor on the calling thread - ROOT has no public
+   way to store a buffer compressed elsewhere, so the write
+   is serial. The keys are ordinary TKeys: the file reads
+   back with plain ROOT, exactly as if each object had been
+   written with TObject::Write. Mostly empty histograms can
+   be written as StSparseHistogram instead, which
+   StSparseHistogram::Get reads back dense
+ */
+
+#ifndef STHISTOGRAMWRITER__HH
+#define STHISTOGRAMWRITER__HH
+
+#include <string>
+#include <vector>
+
+#include "Rtypes.h"
+
+class TObject;
+class TDirectory;
+
+class StHistogramWriter {
+public:
+
+  StHistogramWriter();
+  ~StHistogramWriter();
+
+  /* ROOT compression settings (100 * algorithm + level),
+     by default those of the output file. Algorithms this
+     ROOT does not have fall back to zlib at the same level
+   */
+  void SetCompressionSettings(Int_t settings) {compression_ = settings;}
+  Int_t CompressionSettings() const           {return compression_;}
+
+  /* fast settings for scratch output (LZ4 where ROOT has
+     it), and small settings for archived output (ZSTD, or
+     LZMA before ROOT 6.20)
+   */
+  static Int_t ScratchCompression();
+  static Int_t ArchiveCompression();
+
+  /* writes every histogram as StSparseHistogram (off by
+     default). The choice is the same for every histogram of
+     every job, so a name never has one form in one file and
+     the other form in the next - hadd merges the outputs
+   */
+  void SetSparse(bool sparse) {sparse_ = sparse;}
+  bool Sparse() const         {return sparse_;}
+
+  /* queues obj to be written into the subdirectory dir of
+     the output ("" is the top directory). The writer does
+     not own obj
+   */
+  void Add(TObject* obj, std::string dir = "");
+  void Clear();
+  unsigned Objects() const {return objects_.size();}
+
+  /* writes every queued object under top, and returns the
+     number of bytes written (-1 on error)
+   */
+  Long64_t Write(TDirectory* top);
+
+  // statistics of the last Write
+  double WriteTime() const       {return write_time_;}
+  Long64_t BytesIn() const       {return bytes_in_;}
+  Long64_t BytesOut() const      {return bytes_out_;}
+  unsigned SparseObjects() const {return sparse_objects_;}
+
+private:
+
+  struct Entry {
+    TObject* object;
+    std::string dir;
+  };
+
+  static Int_t EffectiveCompression(Int_t settings);
+
+  std::vector<Entry> objects_;
+  Int_t compression_;
+  bool sparse_;
+
+  double write_time_;
+  Long64_t bytes_in_;
+  Long64_t bytes_out_;
+  unsigned sparse_objects_;
+};
+
+#endif // STHISTOGRAMWRITER__HH
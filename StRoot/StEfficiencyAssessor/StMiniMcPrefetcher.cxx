@@ -0,0 +1,154 @@
+#include "StMiniMcPrefetcher.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "RVersion.h"
+#include "TROOT.h"
+#include "TThread.h"
+#include "TChainElement.h"
+
+#include <algorithm>
+
+StMiniMcPrefetcher::StMiniMcPrefetcher(unsigned depth)
+  : depth_(std::max(depth, 2u)), slots_(depth_), chain_(nullptr), reader_(nullptr),
+    base_(0), head_(0), tail_(0), generation_(0), holding_(false), done_(false),
+    stop_(false), hits_(0), misses_(0), waits_(0) {}
+
+StMiniMcPrefetcher::~StMiniMcPrefetcher() {
+  Stop();
+}
+
+bool StMiniMcPrefetcher::Start(TChain* chain, Long64_t first, Long64_t cacheSize) {
+  Stop();
+  if (chain == nullptr)
+    return false;
+
+  // the thread opens its own files - ROOT's global lists (files,
+  // streamer infos) have to be locked from here on
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+  ROOT::EnableThreadSafety();
+#else
+  TThread::Initialize();
+#endif
+
+  chain_ = new TChain(chain->GetName(), chain->GetTitle());
+  TObjArray* files = chain->GetListOfFiles();
+  for (int i = 0; i < files->GetEntriesFast(); ++i) {
+    TChainElement* element = (TChainElement*) files->UncheckedAt(i);
+    chain_->Add(element->GetTitle(), element->GetEntries());
+  }
+
+  reader_ = new StMiniMcReader();
+  if (!reader_->Open(chain_)) {
+    LOG_ERROR << "miniMC prefetch: could not open chain" << endm;
+    delete reader_;
+    reader_ = nullptr;
+    delete chain_;
+    chain_ = nullptr;
+    return false;
+  }
+  reader_->ConfigureCache(cacheSize);
+
+  base_ = first;
+  head_ = 0;
+  tail_ = 0;
+  generation_ = 0;
+  holding_ = false;
+  done_ = false;
+  stop_ = false;
+  thread_ = std::thread(&StMiniMcPrefetcher::Run, this);
+  LOG_INFO << "miniMC prefetch: decoding ahead into " << depth_ << " event buffers" << endm;
+  return true;
+}
+
+void StMiniMcPrefetcher::Stop() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    consumed_.notify_all();
+    produced_.notify_all();
+    thread_.join();
+  }
+  delete reader_;
+  reader_ = nullptr;
+  delete chain_;
+  chain_ = nullptr;
+  stop_ = false;
+}
+
+const StMiniMcFlatEvent* StMiniMcPrefetcher::Take(Long64_t entry) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  // the event handed out last is given back to the producer
+  if (holding_) {
+    head_++;
+    holding_ = false;
+  }
+
+  Long64_t slot = entry - base_;
+  if (slot < head_ || slot >= head_ + depth_) {
+    consumed_.notify_one();
+    misses_++;
+    return nullptr;
+  }
+
+  // entries before the one asked for will never be used
+  head_ = std::min(slot, tail_);
+  consumed_.notify_one();
+  if (tail_ <= slot && !done_)
+    waits_++;
+  produced_.wait(lock, [&] {return tail_ > slot || done_ || stop_;});
+  if (tail_ <= slot) {
+    misses_++;
+    return nullptr;
+  }
+
+  head_ = slot;
+  holding_ = true;
+  hits_++;
+  return &slots_[slot % depth_];
+}
+
+void StMiniMcPrefetcher::Seek(Long64_t entry) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    base_ = entry;
+    head_ = 0;
+    tail_ = 0;
+    generation_++;
+    holding_ = false;
+    done_ = false;
+  }
+  consumed_.notify_one();
+}
+
+void StMiniMcPrefetcher::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    consumed_.wait(lock, [&] {return stop_ || (!done_ && tail_ - head_ < depth_);});
+    if (stop_)
+      break;
+
+    Long64_t index = tail_;
+    Long64_t entry = base_ + index;
+    unsigned generation = generation_;
+    lock.unlock();
+
+    // slot (tail_ % depth_) is outside the consumer's window, so it
+    // is decoded into without holding the lock
+    bool ok = reader_->Read(entry);
+    if (ok)
+      slots_[index % depth_] = reader_->Event();
+
+    lock.lock();
+    if (generation != generation_)
+      continue;
+    if (ok)
+      tail_++;
+    else
+      done_ = true;
+    produced_.notify_one();
+  }
+}
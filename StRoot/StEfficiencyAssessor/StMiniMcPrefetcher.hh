@@ -0,0 +1,87 @@
+/* internal class for StEfficiencyAssessor
+   decodes miniMC entries on a background thread, in chain
+   order, into a bounded ring of event buffers, so miniMC
+   I/O and decompression overlap with the muDst read and
+   the histogram fills of the main thread
+
+   the thread reads through its own TChain over the same
+   files, so no ROOT object is shared between threads. The
+   consumer asks for entries by number: entries inside the
+   window of the ring are handed out (skipping any in
+   between), anything else is a miss, and the caller reads
+   the entry itself and moves the ring with Seek
+ */
+
+#ifndef STMINIMCPREFETCHER__HH
+#define STMINIMCPREFETCHER__HH
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "StMiniMcReader.hh"
+
+class StMiniMcPrefetcher {
+public:
+
+  /* depth is the number of event buffers in the ring */
+  StMiniMcPrefetcher(unsigned depth = 16);
+  ~StMiniMcPrefetcher();
+
+  /* opens a private copy of the chain and starts decoding
+     at entry first. cacheSize is passed on to the reader of
+     the private chain (see StMiniMcReader::ConfigureCache)
+   */
+  bool Start(TChain* chain, Long64_t first = 0, Long64_t cacheSize = 0);
+
+  /* stops the thread, and waits for it to finish */
+  void Stop();
+
+  /* returns the decoded entry, or nullptr if it is not in
+     the window of the ring or past the end of the chain.
+     The event is valid until the next call to Take or Seek
+   */
+  const StMiniMcFlatEvent* Take(Long64_t entry);
+
+  /* drops the ring, and restarts decoding at entry */
+  void Seek(Long64_t entry);
+
+  unsigned Depth() const  {return depth_;}
+  bool Running() const    {return thread_.joinable();}
+  Long64_t Hits() const   {return hits_;}
+  Long64_t Misses() const {return misses_;}
+  Long64_t Waits() const  {return waits_;}
+
+private:
+
+  void Run();
+
+  unsigned depth_;
+  std::vector<StMiniMcFlatEvent> slots_;
+
+  TChain* chain_;
+  StMiniMcReader* reader_;
+  std::thread thread_;
+
+  /* the ring holds entries [base_ + head_, base_ + tail_).
+     generation_ changes on every Seek, so an entry decoded
+     for an older position is dropped
+   */
+  std::mutex mutex_;
+  std::condition_variable produced_;
+  std::condition_variable consumed_;
+  Long64_t base_;
+  Long64_t head_;
+  Long64_t tail_;
+  unsigned generation_;
+  bool holding_;
+  bool done_;
+  bool stop_;
+
+  Long64_t hits_;
+  Long64_t misses_;
+  Long64_t waits_;
+};
+
+#endif // STMINIMCPREFETCHER__HH
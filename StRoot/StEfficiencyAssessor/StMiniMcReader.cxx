@@ -0,0 +1,391 @@
+#include "StMiniMcReader.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TFile.h"
+#include "TTreeCache.h"
+#include "TChainElement.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+  
+  const char* kColumnNames[] = {
+    "mRunId", "mEventId", "mVertexZ",
+    "mMcTracks", "mMatchedPairs",
+    "mMcTracks.mPtMc", "mMcTracks.mEtaMc", "mMcTracks.mPhiMc",
+    "mMcTracks.mGeantId", "mMcTracks.mParentGeantId",
+    "mMatchedPairs.mPtPr", "mMatchedPairs.mEtaPr", "mMatchedPairs.mPhiPr",
+    "mMatchedPairs.mDcaGl", "mMatchedPairs.mFitPts", "mMatchedPairs.mNPossible",
+    "mMatchedPairs.mGeantId", "mMatchedPairs.mParentGeantId"
+  };
+  
+  // the auto-sized cache holds this many entries of the active branches
+  const Long64_t kCacheEntries = 2000;
+  const Long64_t kMinCacheSize = 2 * 1024 * 1024;
+  const Long64_t kMaxCacheSize = 128 * 1024 * 1024;
+  
+  // read-ahead of the next file starts this far from the end of a file
+  const double kReadAheadFraction = 0.9;
+  
+  enum LeafType {kUnknown, kFloat, kDouble, kInt, kUInt, kShort, kUShort, kChar, kUChar, kBool, kLong64};
+  
+  LeafType TypeOf(const char* name, size_t& size) {
+    std::string type(name);
+    if (type == "Float_t" || type == "Float16_t")   {size = sizeof(Float_t);  return kFloat;}
+    if (type == "Double_t" || type == "Double32_t") {size = sizeof(Double_t); return kDouble;}
+    if (type == "Int_t")                            {size = sizeof(Int_t);    return kInt;}
+    if (type == "UInt_t")                           {size = sizeof(UInt_t);   return kUInt;}
+    if (type == "Short_t")                          {size = sizeof(Short_t);  return kShort;}
+    if (type == "UShort_t")                         {size = sizeof(UShort_t); return kUShort;}
+    if (type == "Char_t")                           {size = sizeof(Char_t);   return kChar;}
+    if (type == "UChar_t")                          {size = sizeof(UChar_t);  return kUChar;}
+    if (type == "Bool_t")                           {size = sizeof(Bool_t);   return kBool;}
+    if (type == "Long64_t")                         {size = sizeof(Long64_t); return kLong64;}
+    size = 0;
+    return kUnknown;
+  }
+  
+  template <typename In, typename Out>
+  void CopyAs(const char* raw, Out* out, int n) {
+    const In* in = (const In*) raw;
+    for (int i = 0; i < n; ++i)
+      out[i] = (Out) in[i];
+  }
+}
+
+StMiniMcReader::StMiniMcReader()
+  : chain_(nullptr), columns_(), mc_capacity_(0), matched_capacity_(0),
+    event_(), entry_(-1), local_(-1), tracks_loaded_(false), read_ahead_(true),
+    tree_number_(-1), read_ahead_tree_(-1), cache_stats_(), harvested_cache_(nullptr),
+    harvested_() {}
+
+StMiniMcReader::~StMiniMcReader() {
+  
+}
+
+std::vector<std::string> StMiniMcReader::BranchNames() {
+  return std::vector<std::string>(kColumnNames, kColumnNames + kNColumns);
+}
+
+void StMiniMcReader::SelectBranches(TTree* tree) {
+  // the TClonesArray branches are enabled for their counts, with
+  // all their members switched off again
+  tree->SetBranchStatus("*", 0);
+  tree->SetBranchStatus("mMcTracks", 1);
+  tree->SetBranchStatus("mMcTracks.*", 0);
+  tree->SetBranchStatus("mMatchedPairs", 1);
+  tree->SetBranchStatus("mMatchedPairs.*", 0);
+  for (int i = 0; i < kNColumns; ++i)
+    tree->SetBranchStatus(kColumnNames[i], 1);
+}
+
+bool StMiniMcReader::Open(TChain* chain) {
+  chain_ = chain;
+  entry_ = -1;
+  local_ = -1;
+  tracks_loaded_ = false;
+  event_ = StMiniMcFlatEvent();
+  tree_number_ = -1;
+  read_ahead_tree_ = -1;
+  cache_stats_ = CacheStats();
+  harvested_cache_ = nullptr;
+  harvested_ = CacheStats();
+  
+  // columns hold the branch pointers the chain updates on every
+  // file change, so the vector must never reallocate after binding
+  columns_.clear();
+  columns_.reserve(kNColumns);
+  for (int i = 0; i < kNColumns; ++i)
+    columns_.push_back(Column(kColumnNames[i]));
+  
+  // only the branches we bind are read
+  chain_->SetMakeClass(1);
+  SelectBranches(chain_);
+  
+  // leaf types are taken from the first tree
+  if (chain_->LoadTree(0) < 0 || chain_->GetTree() == nullptr) {
+    LOG_ERROR << "miniMC chain is empty" << endm;
+    return false;
+  }
+  for (int i = 0; i < kNColumns; ++i) {
+    Column& column = columns_[i];
+    TBranch* branch = chain_->GetTree()->GetBranch(column.name.c_str());
+    TLeaf* leaf = branch ? (TLeaf*) branch->GetListOfLeaves()->At(0) : nullptr;
+    if (leaf == nullptr) {
+      LOG_ERROR << "miniMC tree has no branch " << column.name << endm;
+      return false;
+    }
+    column.type = TypeOf(leaf->GetTypeName(), column.size);
+    if (column.type == kUnknown) {
+      LOG_ERROR << "unsupported leaf type " << leaf->GetTypeName() << " for " << column.name << endm;
+      return false;
+    }
+  }
+  
+  mc_capacity_ = 0;
+  matched_capacity_ = 0;
+  return Reserve(kRunId, kNMatched, 1) &&
+         Reserve(kMcPt, kMcParentGeantId, 64) &&
+         Reserve(kPtPr, kParentGeantId, 64);
+}
+
+bool StMiniMcReader::ReadHeader(Long64_t entry) {
+  if (chain_ == nullptr)
+    return false;
+  
+  // the cache of a file is gone once the chain moves on, so its
+  // statistics are collected before the entry is loaded
+  int treeNumber = chain_->GetTreeNumber();
+  if (treeNumber >= 0) {
+    Long64_t* offsets = chain_->GetTreeOffset();
+    if (entry < offsets[treeNumber] || entry >= offsets[treeNumber + 1])
+      HarvestCacheStats();
+  }
+  
+  Long64_t local = chain_->LoadTree(entry);
+  if (local < 0)
+    return false;
+  
+  if (chain_->GetTreeNumber() != tree_number_) {
+    tree_number_ = chain_->GetTreeNumber();
+    cache_stats_.files++;
+  }
+  if (read_ahead_ && read_ahead_tree_ <= tree_number_ &&
+      local >= kReadAheadFraction * chain_->GetTree()->GetEntries())
+    StartReadAhead(tree_number_ + 1);
+  
+  entry_ = entry;
+  local_ = local;
+  tracks_loaded_ = false;
+  for (int i = kRunId; i <= kVertexZ; ++i)
+    if (!ReadColumn(columns_[i]))
+      return false;
+  
+  event_.runId = Scalar<Int_t>(columns_[kRunId]);
+  event_.eventId = Scalar<Int_t>(columns_[kEventId]);
+  event_.vertexZ = Scalar<Float_t>(columns_[kVertexZ]);
+  return true;
+}
+
+bool StMiniMcReader::ReadTracks() {
+  if (entry_ < 0)
+    return false;
+  if (tracks_loaded_)
+    return true;
+  
+  // the counts come first, so the arrays can be grown before they are read
+  if (!ReadCount(columns_[kNMc]) || !ReadCount(columns_[kNMatched]))
+    return false;
+  event_.nMc = Scalar<Int_t>(columns_[kNMc]);
+  event_.nMatched = Scalar<Int_t>(columns_[kNMatched]);
+  
+  if ((size_t) event_.nMc > mc_capacity_ &&
+      !Reserve(kMcPt, kMcParentGeantId, std::max((size_t) event_.nMc, 2 * mc_capacity_)))
+    return false;
+  if ((size_t) event_.nMatched > matched_capacity_ &&
+      !Reserve(kPtPr, kParentGeantId, std::max((size_t) event_.nMatched, 2 * matched_capacity_)))
+    return false;
+  
+  for (int i = kMcPt; i < kNColumns; ++i)
+    if (!ReadColumn(columns_[i]))
+      return false;
+  
+  int nMc = event_.nMc;
+  Convert(columns_[kMcPt], event_.mcPt, nMc);
+  Convert(columns_[kMcEta], event_.mcEta, nMc);
+  Convert(columns_[kMcPhi], event_.mcPhi, nMc);
+  Convert(columns_[kMcGeantId], event_.mcGeantId, nMc);
+  Convert(columns_[kMcParentGeantId], event_.mcParentGeantId, nMc);
+  
+  int nMatched = event_.nMatched;
+  Convert(columns_[kPtPr], event_.ptPr, nMatched);
+  Convert(columns_[kEtaPr], event_.etaPr, nMatched);
+  Convert(columns_[kPhiPr], event_.phiPr, nMatched);
+  Convert(columns_[kDcaGl], event_.dcaGl, nMatched);
+  Convert(columns_[kFitPts], event_.fitPts, nMatched);
+  Convert(columns_[kNPossiblePts], event_.nPossiblePts, nMatched);
+  Convert(columns_[kGeantId], event_.geantId, nMatched);
+  Convert(columns_[kParentGeantId], event_.parentGeantId, nMatched);
+  
+  tracks_loaded_ = true;
+  return true;
+}
+
+void StMiniMcReader::ConfigureCache(Long64_t size, int learnEntries) {
+  if (chain_ == nullptr)
+    return;
+  if (size < 0) {
+    chain_->SetCacheSize(0);
+    cache_stats_.cacheSize = 0;
+    LOG_INFO << "miniMC read cache disabled" << endm;
+    return;
+  }
+  if (size == 0)
+    size = EstimateCacheSize();
+  
+  chain_->SetCacheSize(size);
+  chain_->SetCacheLearnEntries(learnEntries);
+  for (unsigned i = 0; i < columns_.size(); ++i)
+    chain_->AddBranchToCache(columns_[i].name.c_str(), kFALSE);
+  cache_stats_.cacheSize = size;
+  LOG_INFO << "miniMC read cache: " << size / 1024 << " kB for " << columns_.size()
+           << " branches, learning from " << learnEntries << " entries" << endm;
+}
+
+Long64_t StMiniMcReader::EstimateCacheSize() {
+  // compressed bytes per entry of the active branches in the current file
+  TTree* tree = chain_->GetTree();
+  Long64_t size = kMinCacheSize;
+  if (tree != nullptr && tree->GetEntries() > 0) {
+    Long64_t zipBytes = 0;
+    for (unsigned i = 0; i < columns_.size(); ++i)
+      if (columns_[i].branch != nullptr)
+        zipBytes += columns_[i].branch->GetZipBytes();
+    size = zipBytes / tree->GetEntries() * kCacheEntries;
+  }
+  return std::min(std::max(size, kMinCacheSize), kMaxCacheSize);
+}
+
+void StMiniMcReader::HarvestCacheStats() {
+  TFile* file = chain_->GetCurrentFile();
+  if (file == nullptr)
+    return;
+  TFileCacheRead* cache = file->GetCacheRead(chain_->GetTree());
+  if (cache == nullptr)
+    return;
+  
+  CacheStats current;
+  current.cachedReadCalls = cache->GetReadCalls();
+  current.cachedBytes = cache->GetBytesRead();
+  current.missedReadCalls = cache->GetNoCacheReadCalls();
+  current.missedBytes = cache->GetNoCacheBytesRead();
+  
+  // a new cache, or one whose counters were reset on the file change
+  if (cache != harvested_cache_ || current.cachedReadCalls < harvested_.cachedReadCalls ||
+      current.missedReadCalls < harvested_.missedReadCalls)
+    harvested_ = CacheStats();
+  
+  cache_stats_.cachedReadCalls += current.cachedReadCalls - harvested_.cachedReadCalls;
+  cache_stats_.cachedBytes += current.cachedBytes - harvested_.cachedBytes;
+  cache_stats_.missedReadCalls += current.missedReadCalls - harvested_.missedReadCalls;
+  cache_stats_.missedBytes += current.missedBytes - harvested_.missedBytes;
+  harvested_cache_ = cache;
+  harvested_ = current;
+}
+
+void StMiniMcReader::StartReadAhead(int treeNumber) {
+  read_ahead_tree_ = treeNumber + 1;
+  TObjArray* files = chain_->GetListOfFiles();
+  if (treeNumber >= files->GetEntriesFast())
+    return;
+  const char* fileName = ((TChainElement*) files->UncheckedAt(treeNumber))->GetTitle();
+  
+  // remote files are opened asynchronously - TFile::Open picks up the
+  // handle when the chain reaches the file. Local files are handed to
+  // the kernel's read-ahead
+  if (strstr(fileName, "://") != nullptr && strncmp(fileName, "file://", 7) != 0) {
+    TFile::AsyncOpen(fileName);
+  }
+  else {
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+      return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+  }
+  cache_stats_.readAheads++;
+  LOG_DEBUG << "miniMC read-ahead: " << fileName << endm;
+}
+
+const StMiniMcReader::CacheStats& StMiniMcReader::GetCacheStats() {
+  if (chain_ != nullptr)
+    HarvestCacheStats();
+  return cache_stats_;
+}
+
+void StMiniMcReader::PrintCacheStats() {
+  const CacheStats& total = GetCacheStats();
+  Long64_t reads = total.cachedReadCalls + total.missedReadCalls;
+  LOG_INFO << "miniMC read cache: size " << total.cacheSize / 1024 << " kB, files " << total.files
+           << ", read-aheads " << total.readAheads << endm;
+  LOG_INFO << "miniMC read cache: hits " << total.cachedReadCalls << " (" << total.cachedBytes << " bytes), misses "
+           << total.missedReadCalls << " (" << total.missedBytes << " bytes), hit fraction "
+           << (reads > 0 ? (double) total.cachedReadCalls / reads : 0.0) << endm;
+}
+
+bool StMiniMcReader::Bind(Column& column, size_t capacity) {
+  column.buffer.assign(capacity * column.size, 0);
+  if (chain_->SetBranchAddress(column.name.c_str(), &column.buffer[0], &column.branch) < 0) {
+    LOG_ERROR << "could not bind miniMC branch " << column.name << endm;
+    return false;
+  }
+  return true;
+}
+
+bool StMiniMcReader::Reserve(int first, int last, size_t capacity) {
+  for (int i = first; i <= last; ++i)
+    if (!Bind(columns_[i], capacity))
+      return false;
+  if (first == kMcPt)
+    mc_capacity_ = capacity;
+  else if (first == kPtPr)
+    matched_capacity_ = capacity;
+  return true;
+}
+
+bool StMiniMcReader::ReadColumn(Column& column) {
+  if (column.branch == nullptr || column.branch->GetEntry(local_) < 0) {
+    LOG_ERROR << "could not read miniMC branch " << column.name << " at entry " << entry_ << endm;
+    return false;
+  }
+  return true;
+}
+
+bool StMiniMcReader::ReadCount(Column& column) {
+  // TBranchElement::GetEntry of a TClonesArray branch also reads every
+  // enabled member, into buffers that may still be too small for this
+  // event - TBranch::GetEntry reads the branch's own count alone
+  if (column.branch == nullptr || column.branch->TBranch::GetEntry(local_) < 0) {
+    LOG_ERROR << "could not read miniMC branch " << column.name << " at entry " << entry_ << endm;
+    return false;
+  }
+  return true;
+}
+
+template <typename T>
+void StMiniMcReader::Decode(const Column& column, T* out, int n) {
+  const char* raw = &column.buffer[0];
+  switch (column.type) {
+    case kFloat:  CopyAs<Float_t>(raw, out, n);  break;
+    case kDouble: CopyAs<Double_t>(raw, out, n); break;
+    case kInt:    CopyAs<Int_t>(raw, out, n);    break;
+    case kUInt:   CopyAs<UInt_t>(raw, out, n);   break;
+    case kShort:  CopyAs<Short_t>(raw, out, n);  break;
+    case kUShort: CopyAs<UShort_t>(raw, out, n); break;
+    case kChar:   CopyAs<Char_t>(raw, out, n);   break;
+    case kUChar:  CopyAs<UChar_t>(raw, out, n);  break;
+    case kBool:   CopyAs<Bool_t>(raw, out, n);   break;
+    case kLong64: CopyAs<Long64_t>(raw, out, n); break;
+    default: break;
+  }
+}
+
+template <typename T>
+void StMiniMcReader::Convert(const Column& column, std::vector<T>& out, int n) {
+  out.resize(n);
+  if (n > 0)
+    Decode(column, &out[0], n);
+}
+
+template <typename T>
+T StMiniMcReader::Scalar(const Column& column) {
+  T value = 0;
+  Decode(column, &value, 1);
+  return value;
+}
@@ -0,0 +1,177 @@
+/* internal class for StEfficiencyAssessor
+   reads the StMiniMcTree leaf by leaf instead of through
+   StMiniMcEvent: only the split branches StEfficiencyAssessor
+   uses are enabled, and they are decoded straight into flat,
+   reusable arrays - no TClonesArray or per-track objects
+   are ever constructed
+ 
+   the header (run id, event id, vertex z) and the track
+   arrays are read separately, so the ids of an entry can
+   be checked without decoding its tracks
+ 
+   reads go through a TTreeCache holding only the active
+   branches, and the next file of the chain is read ahead
+   while the current one is still being processed
+ */
+
+#ifndef STMINIMCREADER__HH
+#define STMINIMCREADER__HH
+
+#include <string>
+#include <vector>
+
+#include "TChain.h"
+
+class TBranch;
+class TFileCacheRead;
+
+/* the fields of one StMiniMcEvent that StEfficiencyAssessor
+   uses. Track arrays hold nMc (nMatched) valid entries, their
+   capacity is kept between events
+ */
+struct StMiniMcFlatEvent {
+  Int_t runId;
+  Int_t eventId;
+  Float_t vertexZ;
+  
+  // MC tracks
+  Int_t nMc;
+  std::vector<Float_t> mcPt;
+  std::vector<Float_t> mcEta;
+  std::vector<Float_t> mcPhi;
+  std::vector<Int_t>   mcGeantId;
+  std::vector<Int_t>   mcParentGeantId;
+  
+  // matched pairs
+  Int_t nMatched;
+  std::vector<Float_t> ptPr;
+  std::vector<Float_t> etaPr;
+  std::vector<Float_t> phiPr;
+  std::vector<Float_t> dcaGl;
+  std::vector<Int_t>   fitPts;
+  std::vector<Int_t>   nPossiblePts;
+  std::vector<Int_t>   geantId;
+  std::vector<Int_t>   parentGeantId;
+  
+  StMiniMcFlatEvent() : runId(-1), eventId(-1), vertexZ(0), nMc(0), nMatched(0) {}
+};
+
+class StMiniMcReader {
+public:
+  StMiniMcReader();
+  ~StMiniMcReader();
+  
+  /* switches the chain to MakeClass mode, disables every
+     branch that is not read, and binds the rest. The chain
+     is not owned
+   */
+  bool Open(TChain* chain);
+  
+  /* reads run id, event id and vertex z of a chain entry */
+  bool ReadHeader(Long64_t entry);
+  
+  /* reads the MC & matched track arrays of the entry last
+     passed to ReadHeader
+   */
+  bool ReadTracks();
+  
+  bool Read(Long64_t entry) {return ReadHeader(entry) && ReadTracks();}
+  
+  const StMiniMcFlatEvent& Event() const {return event_;}
+  Long64_t Entry() const                 {return entry_;}
+  bool TracksLoaded() const              {return tracks_loaded_;}
+  
+  /* names of every branch the reader uses */
+  static std::vector<std::string> BranchNames();
+  
+  /* disables every branch of the tree except BranchNames() */
+  static void SelectBranches(TTree* tree);
+  
+  /* sets up a TTreeCache for the active branches. A size of
+     0 sizes the cache from the compressed size of the active
+     branches, a negative size turns the cache off. The cache
+     learns from the first learnEntries entries
+   */
+  void ConfigureCache(Long64_t size = 0, int learnEntries = 10);
+  
+  /* when the reader gets close to the end of a file, start
+     fetching the next file in the chain in the background
+   */
+  void SetReadAhead(bool flag) {read_ahead_ = flag;}
+  bool ReadAhead() const       {return read_ahead_;}
+  
+  /* cache statistics, summed over all files read so far */
+  struct CacheStats {
+    Long64_t cacheSize;
+    Long64_t cachedReadCalls;
+    Long64_t cachedBytes;
+    Long64_t missedReadCalls;
+    Long64_t missedBytes;
+    Long64_t files;
+    Long64_t readAheads;
+    CacheStats() : cacheSize(0), cachedReadCalls(0), cachedBytes(0),
+                   missedReadCalls(0), missedBytes(0), files(0), readAheads(0) {}
+  };
+  const CacheStats& GetCacheStats();
+  void PrintCacheStats();
+  
+private:
+  
+  /* one leaf, read into a raw buffer of the leaf's own type,
+     then converted into the flat event
+   */
+  struct Column {
+    std::string name;
+    int type;
+    size_t size;
+    std::vector<char> buffer;
+    TBranch* branch;
+    
+    Column(std::string n) : name(n), type(0), size(0), buffer(), branch(nullptr) {}
+  };
+  
+  enum ColumnId {
+    kRunId, kEventId, kVertexZ,
+    kNMc, kNMatched,
+    kMcPt, kMcEta, kMcPhi, kMcGeantId, kMcParentGeantId,
+    kPtPr, kEtaPr, kPhiPr, kDcaGl, kFitPts, kNPossiblePts, kGeantId, kParentGeantId,
+    kNColumns
+  };
+  
+  bool Bind(Column& column, size_t capacity);
+  bool Reserve(int first, int last, size_t capacity);
+  bool ReadColumn(Column& column);
+  bool ReadCount(Column& column);
+  
+  Long64_t EstimateCacheSize();
+  void HarvestCacheStats();
+  void StartReadAhead(int treeNumber);
+  
+  template <typename T> void Decode(const Column& column, T* out, int n);
+  template <typename T> void Convert(const Column& column, std::vector<T>& out, int n);
+  template <typename T> T Scalar(const Column& column);
+  
+  TChain* chain_;
+  std::vector<Column> columns_;
+  size_t mc_capacity_;
+  size_t matched_capacity_;
+  
+  StMiniMcFlatEvent event_;
+  Long64_t entry_;
+  Long64_t local_;
+  bool tracks_loaded_;
+  
+  bool read_ahead_;
+  int tree_number_;
+  int read_ahead_tree_;
+  CacheStats cache_stats_;
+  
+  /* the chain moves one cache object from file to file, so
+     statistics are harvested as differences from the last
+     values seen for that cache
+   */
+  const TFileCacheRead* harvested_cache_;
+  CacheStats harvested_;
+};
+
+#endif // STMINIMCREADER__HH
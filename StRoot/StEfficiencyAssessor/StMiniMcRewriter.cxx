@@ -0,0 +1,163 @@
+#include "StMiniMcRewriter.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "StMiniMcEvent/StMiniMcEvent.h"
+
+#include "StEventIndex.hh"
+#include "StMiniMcReader.hh"
+
+#include "RVersion.h"
+#include "TChain.h"
+#include "TFile.h"
+#include "TTree.h"
+
+#include <fstream>
+#include <vector>
+
+ClassImp(StMiniMcRewriter)
+
+namespace {
+
+  // MuEvent is a TClonesArray holding one StMuEvent per entry
+  const int kMaxMuEvents = 4;
+
+  Int_t DefaultCompression() {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+    return 404;  // LZ4, level 4
+#else
+    return 101;  // zlib, level 1
+#endif
+  }
+}
+
+StMiniMcRewriter::StMiniMcRewriter()
+  : mCompression(-1), mKeepUnmatched(kTRUE), mIndexDirectory(""),
+    mEventsWritten(0), mMuDstUnmatched(0), mMiniMcUnmatched(0) {}
+
+StMiniMcRewriter::~StMiniMcRewriter() {
+
+}
+
+Int_t StMiniMcRewriter::CompressionSettings() const {
+  return mCompression < 0 ? DefaultCompression() : mCompression;
+}
+
+Bool_t StMiniMcRewriter::ReadList(const char* fileList, TChain* chain) {
+  std::ifstream file(fileList);
+  if (!file.good()) {
+    LOG_ERROR << "could not open file list: " << fileList << endm;
+    return kFALSE;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty())
+      continue;
+    chain->Add(line.c_str());
+  }
+  if (chain->GetListOfFiles()->GetEntriesFast() == 0) {
+    LOG_ERROR << "file list is empty: " << fileList << endm;
+    return kFALSE;
+  }
+  return kTRUE;
+}
+
+Bool_t StMiniMcRewriter::Rewrite(const char* muFileList, const char* mcFileList, const char* outputFile) {
+  mEventsWritten = 0;
+  mMuDstUnmatched = 0;
+  mMiniMcUnmatched = 0;
+
+  TChain muChain("MuDst");
+  TChain mcChain("StMiniMcTree");
+  if (!ReadList(muFileList, &muChain) || !ReadList(mcFileList, &mcChain))
+    return kFALSE;
+
+  // the muDst event order, read from the id leaves only
+  Int_t nMuEvents = 0;
+  Int_t runIds[kMaxMuEvents];
+  Int_t eventIds[kMaxMuEvents];
+  muChain.SetMakeClass(1);
+  muChain.SetBranchStatus("*", 0);
+  muChain.SetBranchStatus("MuEvent", 1);
+  muChain.SetBranchStatus("MuEvent.mEventInfo.mRunId", 1);
+  muChain.SetBranchStatus("MuEvent.mEventInfo.mId", 1);
+  if (muChain.SetBranchAddress("MuEvent", &nMuEvents) < 0 ||
+      muChain.SetBranchAddress("MuEvent.mEventInfo.mRunId", runIds) < 0 ||
+      muChain.SetBranchAddress("MuEvent.mEventInfo.mId", eventIds) < 0) {
+    LOG_ERROR << "could not read event ids from MuDst chain" << endm;
+    return kFALSE;
+  }
+
+  std::vector<ULong64_t> order;
+  for (Long64_t i = 0; muChain.LoadTree(i) >= 0; ++i) {
+    muChain.GetEntry(i);
+    if (nMuEvents < 1 || nMuEvents > kMaxMuEvents)
+      continue;
+    order.push_back(StEventIndex::Key(runIds[0], eventIds[0]));
+  }
+  LOG_INFO << "miniMC rewrite: " << order.size() << " muDst events" << endm;
+
+  StEventIndex index;
+  index.SetSidecarDirectory(mIndexDirectory);
+  if (!index.Build(&mcChain))
+    return kFALSE;
+
+  // only the branches the assessor reads are copied
+  StMiniMcEvent* event = nullptr;
+  StMiniMcReader::SelectBranches(&mcChain);
+  mcChain.SetBranchStatus("StMiniMcEvent", 1);
+  mcChain.SetBranchAddress("StMiniMcEvent", &event);
+  if (mcChain.LoadTree(0) < 0) {
+    LOG_ERROR << "miniMC chain is empty" << endm;
+    return kFALSE;
+  }
+
+  TFile* out = TFile::Open(outputFile, "RECREATE");
+  if (out == nullptr || out->IsZombie()) {
+    LOG_ERROR << "could not create output file: " << outputFile << endm;
+    delete out;
+    return kFALSE;
+  }
+  out->SetCompressionSettings(CompressionSettings());
+  TTree* tree = mcChain.CloneTree(0);
+
+  // the muDst order is followed once per miniMC entry - a muDst event
+  // that appears twice does not duplicate its miniMC partner
+  std::vector<bool> written(index.Entries(), false);
+  for (size_t i = 0; i < order.size(); ++i) {
+    Long64_t entry = index.Find((Int_t) (order[i] >> 32), (Int_t) (order[i] & 0xffffffff));
+    if (entry < 0) {
+      mMuDstUnmatched++;
+      continue;
+    }
+    if (written[entry])
+      continue;
+    mcChain.GetEntry(entry);
+    tree->Fill();
+    written[entry] = true;
+    mEventsWritten++;
+  }
+
+  for (size_t entry = 0; entry < written.size(); ++entry) {
+    if (written[entry])
+      continue;
+    mMiniMcUnmatched++;
+    if (mKeepUnmatched) {
+      mcChain.GetEntry(entry);
+      tree->Fill();
+      mEventsWritten++;
+    }
+  }
+
+  out->cd();
+  tree->Write();
+  out->Close();
+  delete out;
+
+  LOG_INFO << "miniMC rewrite: " << mEventsWritten << " events written to " << outputFile
+           << " (compression " << CompressionSettings() << ")" << endm;
+  LOG_INFO << "miniMC rewrite: muDst events without miniMC partner: " << mMuDstUnmatched << endm;
+  LOG_INFO << "miniMC rewrite: miniMC events without muDst partner: " << mMiniMcUnmatched
+           << (mKeepUnmatched ? " (appended)" : " (dropped)") << endm;
+  return kTRUE;
+}
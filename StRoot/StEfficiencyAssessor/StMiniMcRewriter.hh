@@ -0,0 +1,73 @@
+/* offline tool for StEfficiencyAssessor
+   rewrites a miniMC chain in the (runId, eventId) order
+   of a muDst list, keeping only the branches that
+   StEfficiencyAssessor reads, with a fast compression
+   setting. An assessor pass over the same muDst list
+   then reads the rewritten miniMC file sequentially
+
+   see StRoot/macros/rewrite_minimc.cxx
+ */
+
+#ifndef STMINIMCREWRITER__HH
+#define STMINIMCREWRITER__HH
+
+#include "TObject.h"
+
+#include <string>
+
+class TChain;
+
+class StMiniMcRewriter : public TObject {
+
+public:
+
+  StMiniMcRewriter();
+  ~StMiniMcRewriter();
+
+  /* ROOT compression settings (100 * algorithm + level) of
+     the output. The default is LZ4 level 4 where ROOT has
+     it, zlib level 1 otherwise
+   */
+  void SetCompressionSettings(Int_t settings) {mCompression = settings;}
+  Int_t CompressionSettings() const;
+
+  /* miniMC events that no muDst event points to are
+     appended after the sorted events, in chain order. On
+     by default, so no event is lost in the rewrite
+   */
+  void KeepUnmatched(Bool_t flag) {mKeepUnmatched = flag;}
+  Bool_t KeepUnmatched() const    {return mKeepUnmatched;}
+
+  /* the (runId, eventId) index of the miniMC chain is read
+     from (and written to) sidecar files, as in the assessor
+   */
+  void SetIndexDirectory(std::string dir) {mIndexDirectory = dir;}
+  std::string IndexDirectory() const     {return mIndexDirectory;}
+
+  /* muFileList & mcFileList hold one file per line. Returns
+     false if either chain can not be read, or the output
+     can not be written
+   */
+  Bool_t Rewrite(const char* muFileList, const char* mcFileList, const char* outputFile);
+
+  /* statistics of the last Rewrite() */
+  Long64_t EventsWritten() const   {return mEventsWritten;}
+  Long64_t MuDstUnmatched() const  {return mMuDstUnmatched;}
+  Long64_t MiniMcUnmatched() const {return mMiniMcUnmatched;}
+
+private:
+
+  Bool_t ReadList(const char* fileList, TChain* chain);
+
+  Int_t       mCompression;
+  Bool_t      mKeepUnmatched;
+  std::string mIndexDirectory;
+
+  Long64_t mEventsWritten;
+  Long64_t mMuDstUnmatched;
+  Long64_t mMiniMcUnmatched;
+
+  ClassDef(StMiniMcRewriter, 1)
+};
+
+#endif // STMINIMCREWRITER__HH
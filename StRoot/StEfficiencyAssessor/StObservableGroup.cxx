@@ -0,0 +1,75 @@
+#include "StObservableGroup.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "TH3D.h"
+
+StObservableGroup::StObservableGroup(TH3D* const* targets, unsigned n)
+  : targets_(targets, targets + n), x_(targets[0]->GetXaxis()), y_(targets[0]->GetYaxis()),
+    stride_(0), stat_overflows_(TH1::GetStatOverflows()), entries_(0), stats_(n * kNStats, 0.0) {
+  for (unsigned i = 0; i < n; ++i) {
+    if (StDenseHistogram::Axis(targets[i]->GetXaxis()) != x_ ||
+        StDenseHistogram::Axis(targets[i]->GetYaxis()) != y_)
+      LOG_ERROR << "observable group: " << targets[i]->GetName() << " is binned differently in x or y from "
+                << targets[0]->GetName() << endm;
+    z_.push_back(StDenseHistogram::Axis(targets[i]->GetZaxis()));
+    offsets_.push_back(stride_);
+    stride_ += z_.back().cells;
+  }
+  counts_.assign((size_t) x_.cells * y_.cells * stride_, 0);
+}
+
+StObservableGroup::~StObservableGroup() {
+
+}
+
+void StObservableGroup::Flush() {
+  if (entries_ == 0)
+    return;
+  for (size_t i = 0; i < targets_.size(); ++i) {
+    TH3D* target = targets_[i];
+    Double_t entries = target->GetEntries();
+
+    // from the block layout back to ROOT's global bins
+    TArrayD* sumw2 = target->GetSumw2N() > 0 ? target->GetSumw2() : nullptr;
+    for (int by = 0; by < y_.cells; ++by) {
+      for (int bx = 0; bx < x_.cells; ++bx) {
+        const uint32_t* block = &counts_[(size_t) (bx + x_.cells * by) * stride_ + offsets_[i]];
+        for (int bz = 0; bz < z_[i].cells; ++bz) {
+          if (block[bz] == 0)
+            continue;
+          Int_t cell = bx + x_.cells * (by + y_.cells * bz);
+          target->AddBinContent(cell, block[bz]);
+          if (sumw2 != nullptr)
+            sumw2->fArray[cell] += block[bz];
+        }
+      }
+    }
+
+    // set, not added, as in StDenseHistogram::Flush
+    Double_t stats[TH1::kNstat];
+    for (int s = 0; s < TH1::kNstat; ++s)
+      stats[s] = s < kNStats ? stats_[i * kNStats + s] : 0;
+    target->PutStats(stats);
+    target->SetEntries(entries + entries_);
+  }
+  std::fill(counts_.begin(), counts_.end(), 0);
+  entries_ = 0;
+}
+
+void StObservableGroup::Reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  std::fill(stats_.begin(), stats_.end(), 0.0);
+  entries_ = 0;
+}
+
+void StObservableGroup::Sync() {
+  for (size_t i = 0; i < targets_.size(); ++i) {
+    Double_t stats[TH1::kNstat];
+    for (int s = 0; s < TH1::kNstat; ++s)
+      stats[s] = 0;
+    targets_[i]->GetStats(stats);
+    for (int s = 0; s < kNStats; ++s)
+      stats_[i * kNStats + s] = stats[s];
+  }
+}
@@ -0,0 +1,104 @@
+/* internal class for StEfficiencyAssessor
+   a family of TH3s that are always filled together at the
+   same (x, y) - e.g. (centrality, pt) of a track - each with
+   its own observable on z. Fill finds the (x, y) bin once
+   and writes the z bin of every observable into one block of
+   counters: the storage is (x, y)-major, with the z bins of
+   all observables of an (x, y) bin next to each other, so
+   one track touches a single contiguous block instead of one
+   cache line in each of n separate histograms
+
+   like StDenseHistogram, the counts are added to the target
+   TH3s with Flush(), which sets their statistics to sums run
+   since the last Reset() - the targets are identical to TH3s
+   filled directly, whatever the flush points. The targets
+   are not owned
+ */
+
+#ifndef STOBSERVABLEGROUP__HH
+#define STOBSERVABLEGROUP__HH
+
+#include "StDenseHistogram.hh"
+
+#include <vector>
+
+class TH3D;
+
+class StObservableGroup {
+public:
+
+  /* the targets share their x & y binning - the group takes
+     it from the first one
+   */
+  StObservableGroup(TH3D* const* targets, unsigned n);
+  ~StObservableGroup();
+
+  unsigned Size() const          {return targets_.size();}
+  TH3D* Target(unsigned i) const {return targets_[i];}
+
+  /* z holds one value per target, in the order of the targets */
+  inline void Fill(double x, double y, const double* z) {
+    int bx = x_.Bin(x);
+    int by = y_.Bin(y);
+    uint32_t* block = &counts_[(size_t) (bx + x_.cells * by) * stride_];
+    ++entries_;
+    bool inRange = InRange(x_, bx) && InRange(y_, by);
+    double xx = x * x;
+    double yy = y * y;
+    double xy = x * y;
+    for (size_t i = 0; i < z_.size(); ++i) {
+      int bz = z_[i].Bin(z[i]);
+      ++block[offsets_[i] + bz];
+      if (!inRange || !InRange(z_[i], bz))
+        continue;
+      double* stats = &stats_[i * kNStats];
+      stats[0] += 1; stats[1] += 1;
+      stats[2] += x; stats[3] += xx;
+      stats[4] += y; stats[5] += yy;
+      stats[6] += xy;
+      stats[7] += z[i]; stats[8] += z[i] * z[i];
+      stats[9] += x * z[i]; stats[10] += y * z[i];
+    }
+  }
+
+  /* adds everything filled since the last flush to the targets */
+  void Flush();
+
+  /* zeroes the counters & the statistics, for targets that are
+     reset too
+   */
+  void Reset();
+
+  /* continues the statistics from those of the targets - after
+     they were restored from a checkpoint
+   */
+  void Sync();
+
+  /* memory held by the counters */
+  size_t Bytes() const {return counts_.size() * sizeof(uint32_t);}
+
+private:
+
+  StObservableGroup(const StObservableGroup&);
+  StObservableGroup& operator=(const StObservableGroup&);
+
+  static const int kNStats = 11;
+
+  inline bool InRange(const StDenseHistogram::Axis& axis, int bin) const {
+    return stat_overflows_ || (bin > 0 && bin <= (int) axis.nBins);
+  }
+
+  std::vector<TH3D*> targets_;
+  StDenseHistogram::Axis x_;
+  StDenseHistogram::Axis y_;
+  std::vector<StDenseHistogram::Axis> z_;
+  std::vector<int> offsets_;    // of each target's z bins in a block
+  int stride_;                  // counters per (x, y) bin
+  bool stat_overflows_;
+
+  std::vector<uint32_t> counts_;
+  Long64_t entries_;
+  std::vector<double> stats_;   // kNStats per target
+};
+
+#endif // STOBSERVABLEGROUP__HH
@@ -0,0 +1,226 @@
+#include "StSparseHistogram.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "TClass.h"
+#include "TCollection.h"
+#include "TDirectory.h"
+#include "TH1.h"
+#include "TKey.h"
+
+#include <vector>
+
+ClassImp(StSparseHistogram)
+
+namespace {
+
+  /* the bin edges of axis, for TH1::SetBins */
+  std::vector<Double_t> Edges(const TAxis& axis) {
+    std::vector<Double_t> edges(axis.GetNbins() + 1);
+    for (Int_t i = 1; i <= axis.GetNbins() + 1; ++i)
+      edges[i - 1] = axis.GetBinLowEdge(i);
+    return edges;
+  }
+}
+
+StSparseHistogram::StSparseHistogram()
+  : mDimension(0), mEntries(0), mHasSumw2(kFALSE) {}
+
+StSparseHistogram::StSparseHistogram(const TH1& hist)
+  : TNamed(hist.GetName(), hist.GetTitle()), mClassName(hist.ClassName()),
+    mDimension(hist.GetDimension()), mEntries(hist.GetEntries()), mStats(TH1::kNstat, 0.0),
+    mHasSumw2(hist.GetSumw2N() > 0) {
+  hist.GetXaxis()->Copy(mXaxis);
+  hist.GetYaxis()->Copy(mYaxis);
+  hist.GetZaxis()->Copy(mZaxis);
+  hist.GetStats(&mStats[0]);
+
+  const TArrayD* sumw2 = mHasSumw2 ? hist.GetSumw2() : nullptr;
+  for (Int_t bin = 0; bin < hist.GetNcells(); ++bin) {
+    Double_t content = hist.GetBinContent(bin);
+    Double_t w2 = sumw2 != nullptr ? sumw2->At(bin) : 0.0;
+    if (content == 0.0 && w2 == 0.0)
+      continue;
+    mBins.push_back(bin);
+    mContents.push_back(content);
+    if (mHasSumw2)
+      mSumw2.push_back(w2);
+  }
+}
+
+StSparseHistogram::~StSparseHistogram() {
+
+}
+
+Double_t StSparseHistogram::Occupancy(const TH1& hist) {
+  const TArrayD* sumw2 = hist.GetSumw2N() > 0 ? hist.GetSumw2() : nullptr;
+  Int_t filled = 0;
+  for (Int_t bin = 0; bin < hist.GetNcells(); ++bin) {
+    if (hist.GetBinContent(bin) != 0.0 || (sumw2 != nullptr && sumw2->At(bin) != 0.0))
+      filled++;
+  }
+  return hist.GetNcells() > 0 ? (Double_t) filled / hist.GetNcells() : 0.0;
+}
+
+Int_t StSparseHistogram::Cells() const {
+  Int_t cells = mXaxis.GetNbins() + 2;
+  if (mDimension > 1)
+    cells *= mYaxis.GetNbins() + 2;
+  if (mDimension > 2)
+    cells *= mZaxis.GetNbins() + 2;
+  return cells;
+}
+
+TH1* StSparseHistogram::Dense() const {
+  TClass* cl = TClass::GetClass(mClassName.Data());
+  if (cl == nullptr || !cl->InheritsFrom(TH1::Class())) {
+    LOG_ERROR << "sparse histogram " << GetName() << ": unknown class " << mClassName << endm;
+    return nullptr;
+  }
+  TH1* hist = (TH1*) cl->New();
+  hist->SetDirectory(nullptr);
+  hist->SetName(GetName());
+  hist->SetTitle(GetTitle());
+
+  std::vector<Double_t> x = Edges(mXaxis);
+  std::vector<Double_t> y = Edges(mYaxis);
+  std::vector<Double_t> z = Edges(mZaxis);
+  if (mDimension == 1)
+    hist->SetBins(mXaxis.GetNbins(), &x[0]);
+  else if (mDimension == 2)
+    hist->SetBins(mXaxis.GetNbins(), &x[0], mYaxis.GetNbins(), &y[0]);
+  else
+    hist->SetBins(mXaxis.GetNbins(), &x[0], mYaxis.GetNbins(), &y[0], mZaxis.GetNbins(), &z[0]);
+  // restores uniform binning, titles & labels
+  mXaxis.Copy(*hist->GetXaxis());
+  mYaxis.Copy(*hist->GetYaxis());
+  mZaxis.Copy(*hist->GetZaxis());
+  hist->GetXaxis()->SetParent(hist);
+  hist->GetYaxis()->SetParent(hist);
+  hist->GetZaxis()->SetParent(hist);
+
+  if (mHasSumw2)
+    hist->Sumw2();
+  for (size_t i = 0; i < mBins.size(); ++i) {
+    hist->SetBinContent(mBins[i], mContents[i]);
+    if (mHasSumw2)
+      (*hist->GetSumw2())[mBins[i]] = mSumw2[i];
+  }
+
+  // SetBinContent resets the statistics
+  hist->SetEntries(mEntries);
+  if (mStats.size() == (size_t) TH1::kNstat) {
+    std::vector<Double_t> stats(mStats);
+    hist->PutStats(&stats[0]);
+  }
+  return hist;
+}
+
+TH1* StSparseHistogram::Get(TDirectory* dir, const char* name) {
+  TKey* key = dir != nullptr ? dir->GetKey(name) : nullptr;
+  if (key == nullptr)
+    return nullptr;
+  TObject* obj = key->ReadObj();
+  if (obj == nullptr)
+    return nullptr;
+  if (obj->InheritsFrom(TH1::Class())) {
+    ((TH1*) obj)->SetDirectory(nullptr);
+    return (TH1*) obj;
+  }
+  TH1* hist = nullptr;
+  if (obj->InheritsFrom(StSparseHistogram::Class()))
+    hist = ((StSparseHistogram*) obj)->Dense();
+  delete obj;
+  return hist;
+}
+
+Bool_t StSparseHistogram::SameBinning(const StSparseHistogram& other) const {
+  if (mDimension != other.mDimension)
+    return kFALSE;
+  const TAxis* axes[3] = {&mXaxis, &mYaxis, &mZaxis};
+  const TAxis* others[3] = {&other.mXaxis, &other.mYaxis, &other.mZaxis};
+  for (Int_t i = 0; i < mDimension; ++i) {
+    if (axes[i]->GetNbins() != others[i]->GetNbins() ||
+        axes[i]->GetXmin() != others[i]->GetXmin() ||
+        axes[i]->GetXmax() != others[i]->GetXmax())
+      return kFALSE;
+    const TArrayD* edges = axes[i]->GetXbins();
+    const TArrayD* otherEdges = others[i]->GetXbins();
+    if (edges->GetSize() != otherEdges->GetSize())
+      return kFALSE;
+    for (Int_t e = 0; e < edges->GetSize(); ++e)
+      if (edges->At(e) != otherEdges->At(e))
+        return kFALSE;
+  }
+  return kTRUE;
+}
+
+void StSparseHistogram::Add(const StSparseHistogram& other) {
+  // without Sumw2 the squared weights are the contents
+  if (!mHasSumw2 && other.mHasSumw2) {
+    mSumw2 = mContents;
+    mHasSumw2 = kTRUE;
+  }
+  const std::vector<Double_t>& otherSumw2 = other.mHasSumw2 ? other.mSumw2 : other.mContents;
+
+  // both bin lists are sorted - walk them together
+  std::vector<Int_t> bins;
+  std::vector<Double_t> contents;
+  std::vector<Double_t> sumw2;
+  bins.reserve(mBins.size() + other.mBins.size());
+  contents.reserve(bins.capacity());
+  if (mHasSumw2)
+    sumw2.reserve(bins.capacity());
+
+  size_t i = 0, j = 0;
+  while (i < mBins.size() || j < other.mBins.size()) {
+    bool mine = j == other.mBins.size() || (i < mBins.size() && mBins[i] <= other.mBins[j]);
+    bool theirs = i == mBins.size() || (j < other.mBins.size() && other.mBins[j] <= mBins[i]);
+    Int_t bin = mine ? mBins[i] : other.mBins[j];
+    Double_t content = (mine ? mContents[i] : 0.0) + (theirs ? other.mContents[j] : 0.0);
+    bins.push_back(bin);
+    contents.push_back(content);
+    if (mHasSumw2)
+      sumw2.push_back((mine ? mSumw2[i] : 0.0) + (theirs ? otherSumw2[j] : 0.0));
+    if (mine)
+      i++;
+    if (theirs)
+      j++;
+  }
+  mBins.swap(bins);
+  mContents.swap(contents);
+  mSumw2.swap(sumw2);
+
+  mEntries += other.mEntries;
+  for (size_t k = 0; k < mStats.size() && k < other.mStats.size(); ++k)
+    mStats[k] += other.mStats[k];
+}
+
+Long64_t StSparseHistogram::Merge(TCollection* list) {
+  if (list == nullptr)
+    return (Long64_t) mEntries;
+  TIter next(list);
+  while (TObject* obj = next()) {
+    // a dense histogram of the same name, from a job written dense
+    if (obj->InheritsFrom(TH1::Class())) {
+      StSparseHistogram other(*(const TH1*) obj);
+      if (!SameBinning(other)) {
+        LOG_ERROR << "sparse histogram " << GetName() << ": can not merge different binning" << endm;
+        return -1;
+      }
+      Add(other);
+      continue;
+    }
+    if (!obj->InheritsFrom(StSparseHistogram::Class())) {
+      LOG_ERROR << "sparse histogram " << GetName() << ": can not merge " << obj->ClassName() << endm;
+      return -1;
+    }
+    const StSparseHistogram* other = (const StSparseHistogram*) obj;
+    if (!SameBinning(*other)) {
+      LOG_ERROR << "sparse histogram " << GetName() << ": can not merge different binning" << endm;
+      return -1;
+    }
+    Add(*other);
+  }
+  return (Long64_t) mEntries;
+}
@@ -0,0 +1,89 @@
+/* helper class for StEfficiencyAssessor output
+   a mostly empty TH1, TH2 or TH3 stored as the list of
+   its filled bins: global bin number, content, and sum of
+   squared weights (if the histogram has them). The axes,
+   title, entries & statistics are kept, so Dense() gives
+   back a histogram identical in binning, content, errors
+   and statistics. Other attributes (line & fill styles,
+   functions, min & max) are not kept
+
+   written in place of every histogram when the assessor
+   output is sparse (see StHistogramWriter), under the
+   name of the histogram. Get() reads either form back as
+   a dense histogram, and Merge() adds sparse histograms
+   without densifying them, so hadd merges them directly.
+   Merge() also takes dense histograms of the same
+   binning - TH1::Merge can not take sparse ones, so a
+   mixed merge has to start from a sparse file
+ */
+
+#ifndef STSPARSEHISTOGRAM__HH
+#define STSPARSEHISTOGRAM__HH
+
+#include "TNamed.h"
+#include "TAxis.h"
+
+#include <vector>
+
+class TH1;
+class TCollection;
+class TDirectory;
+
+class StSparseHistogram : public TNamed {
+
+public:
+
+  StSparseHistogram();
+  StSparseHistogram(const TH1& hist);
+  ~StSparseHistogram();
+
+  /* the fraction of cells (including under- & overflow)
+     of hist with content or error
+   */
+  static Double_t Occupancy(const TH1& hist);
+
+  /* rebuilds the dense histogram - owned by the caller,
+     and not attached to any directory
+   */
+  TH1* Dense() const;
+
+  /* reads name from dir, dense or sparse, as a dense
+     histogram owned by the caller. nullptr if there is no
+     histogram of that name
+   */
+  static TH1* Get(TDirectory* dir, const char* name);
+
+  /* adds the sparse or dense histograms in list to this
+     one, for hadd & TFileMerger. The binning has to be
+     identical
+   */
+  Long64_t Merge(TCollection* list);
+
+  Int_t Dimension() const   {return mDimension;}
+  Int_t FilledBins() const  {return mBins.size();}
+  Int_t Cells() const;
+
+private:
+
+  Bool_t SameBinning(const StSparseHistogram& other) const;
+  void Add(const StSparseHistogram& other);
+
+  TString mClassName;
+  Int_t   mDimension;
+  TAxis   mXaxis;
+  TAxis   mYaxis;
+  TAxis   mZaxis;
+
+  Double_t mEntries;
+  std::vector<Double_t> mStats;
+
+  // filled cells, in increasing global bin number
+  Bool_t mHasSumw2;
+  std::vector<Int_t>    mBins;
+  std::vector<Double_t> mContents;
+  std::vector<Double_t> mSumw2;
+
+  ClassDef(StSparseHistogram, 1)
+};
+
+#endif // STSPARSEHISTOGRAM__HH
@@ -0,0 +1,287 @@
+#include "StStageIn.hh"
+
+#include "St_base/StMessMgr.h"
+
+#include "TFile.h"
+#include "TChainElement.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+namespace {
+
+  const size_t kCopyBufferSize = 4 * 1024 * 1024;
+
+  bool IsRemote(const std::string& path) {
+    return path.find("://") != std::string::npos && path.compare(0, 7, "file://") != 0;
+  }
+
+  std::string BaseName(const std::string& path) {
+    return path.substr(path.find_last_of('/') + 1);
+  }
+}
+
+StStageIn::StStageIn(std::string dir, unsigned lookahead, Long64_t maxBytes)
+  : dir_(), lookahead_(std::max(lookahead, 1u)), max_bytes_(maxBytes), reserved_bytes_(0),
+    streams_(), all_jobs_(), thread_(), stop_(false), n_staged_(0), n_direct_(0),
+    n_failed_(0), n_late_(0), bytes_copied_(0) {
+  // a directory per process, so jobs sharing scratch space never collide
+  std::ostringstream path;
+  path << dir << "/StStageIn." << getpid();
+  dir_ = path.str();
+  if (mkdir(dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+    LOG_WARN << "stage-in: could not create " << dir_ << " - all files are read in place" << endm;
+    max_bytes_ = 0;
+  }
+  thread_ = std::thread(&StStageIn::Run, this);
+}
+
+StStageIn::~StStageIn() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  queued_.notify_all();
+  thread_.join();
+
+  for (unsigned i = 0; i < all_jobs_.size(); ++i) {
+    Remove(all_jobs_[i]);
+    delete all_jobs_[i];
+  }
+  rmdir(dir_.c_str());
+}
+
+void StStageIn::AddChain(TChain* chain) {
+  std::vector<std::string> files;
+  TObjArray* elements = chain->GetListOfFiles();
+  for (int i = 0; i < elements->GetEntriesFast(); ++i)
+    files.push_back(elements->At(i)->GetTitle());
+  AddStream(files, chain, true);
+}
+
+void StStageIn::AddFiles(const std::vector<std::string>& files, TChain* follow) {
+  AddStream(files, follow, false);
+}
+
+void StStageIn::AddStream(const std::vector<std::string>& files, TChain* follow, bool patch) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stream stream;
+  stream.follow = follow;
+  stream.patch = patch;
+  for (unsigned i = 0; i < files.size(); ++i) {
+    Job* job = new Job();
+    job->source = files[i];
+    job->target = dir_ + "/" + BaseName(files[i]);
+    job->element = nullptr;
+    job->size = 0;
+    job->state = files[i].empty() ? kDirect : kPending;
+    job->used = false;
+
+    // two inputs with the same name can not share the stage directory
+    for (unsigned j = 0; j < all_jobs_.size(); ++j)
+      if (!files[i].empty() && all_jobs_[j]->target == job->target)
+        job->state = kDirect;
+
+    stream.jobs.push_back(job);
+    all_jobs_.push_back(job);
+  }
+  streams_.push_back(stream);
+}
+
+void StStageIn::Update() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (unsigned s = 0; s < streams_.size(); ++s) {
+    Stream& stream = streams_[s];
+    int current = std::max(stream.follow->GetTreeNumber(), 0);
+    int last = std::min<int>(current + lookahead_, stream.jobs.size() - 1);
+
+    // copies of finished files are not needed anymore
+    for (int i = 0; i < current && i < (int) stream.jobs.size(); ++i)
+      if (stream.jobs[i]->state != kRemoved && stream.jobs[i]->state != kDirect)
+        Remove(stream.jobs[i]);
+
+    for (int i = current + 1; i <= last; ++i)
+      if (stream.jobs[i]->state == kPending)
+        Queue(stream.jobs[i]);
+
+    if (!stream.patch)
+      continue;
+
+    // a copy that finished after its file was opened is of no use
+    Job* open = current < (int) stream.jobs.size() ? stream.jobs[current] : nullptr;
+    if (open != nullptr && current > 0 && !open->used &&
+        (open->state == kStaged || open->state == kCopying)) {
+      n_late_++;
+      Remove(open);
+    }
+
+    // the chain opens the staged copy when it gets to the file
+    TObjArray* elements = stream.follow->GetListOfFiles();
+    for (int i = current + 1; i <= last; ++i) {
+      Job* job = stream.jobs[i];
+      if (job->state == kStaged && !job->used) {
+        job->element = (TChainElement*) elements->At(i);
+        job->element->SetTitle(job->target.c_str());
+        job->used = true;
+      }
+    }
+  }
+}
+
+std::string StStageIn::Resolve(const std::string& source) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (unsigned s = 0; s < streams_.size(); ++s) {
+    if (streams_[s].patch)
+      continue;
+    for (unsigned i = 0; i < streams_[s].jobs.size(); ++i) {
+      Job* job = streams_[s].jobs[i];
+      if (job->source == source && job->state == kStaged) {
+        job->used = true;
+        return job->target;
+      }
+    }
+  }
+  return source;
+}
+
+void StStageIn::Queue(Job* job) {
+  // remote files are not copied - opening them ahead is enough to
+  // hide the connection latency
+  if (IsRemote(job->source)) {
+    TFile::AsyncOpen(job->source.c_str());
+    job->state = kDirect;
+    n_direct_++;
+    return;
+  }
+
+  struct stat st;
+  struct statvfs fs;
+  if (stat(job->source.c_str(), &st) != 0 || statvfs(dir_.c_str(), &fs) != 0) {
+    job->state = kDirect;
+    n_direct_++;
+    return;
+  }
+  job->size = st.st_size;
+  Long64_t available = (Long64_t) fs.f_bavail * fs.f_frsize;
+  if (reserved_bytes_ + job->size > max_bytes_ || job->size > available) {
+    LOG_INFO << "stage-in: disk limit reached, reading in place: " << job->source << endm;
+    job->state = kDirect;
+    n_direct_++;
+    return;
+  }
+
+  reserved_bytes_ += job->size;
+  job->state = kQueued;
+  queue_.push_back(job);
+  queued_.notify_one();
+}
+
+void StStageIn::Remove(Job* job) {
+  // a copy in progress is removed by the thread once it finishes
+  if (job->state == kQueued || job->state == kCopying || job->state == kStaged)
+    reserved_bytes_ -= job->size;
+  if (job->state == kStaged)
+    unlink(job->target.c_str());
+  // the chain reads the file in place, should it come back to it
+  if (job->element != nullptr) {
+    job->element->SetTitle(job->source.c_str());
+    job->element = nullptr;
+  }
+  job->state = kRemoved;
+}
+
+bool StStageIn::Copy(const Job& job) {
+  std::string partial = job.target + ".part";
+  int in = open(job.source.c_str(), O_RDONLY);
+  if (in < 0)
+    return false;
+  int out = open(partial.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out < 0) {
+    close(in);
+    return false;
+  }
+  posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  std::vector<char> buffer(kCopyBufferSize);
+  bool ok = true;
+  while (ok && !stop_) {
+    ssize_t n = read(in, &buffer[0], buffer.size());
+    if (n == 0)
+      break;
+    if (n < 0) {
+      ok = errno == EINTR;
+      continue;
+    }
+    for (ssize_t done = 0; ok && done < n;) {
+      ssize_t w = write(out, &buffer[done], n - done);
+      if (w < 0 && errno != EINTR)
+        ok = false;
+      else if (w > 0)
+        done += w;
+    }
+  }
+  ok = ok && !stop_;
+
+  // the copy keeps the modification time of the source, so event index
+  // sidecars stay valid for it
+  struct stat st;
+  if (ok && fstat(in, &st) == 0) {
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    futimens(out, times);
+  }
+  close(in);
+  ok = close(out) == 0 && ok;
+
+  if (ok)
+    ok = rename(partial.c_str(), job.target.c_str()) == 0;
+  if (!ok)
+    unlink(partial.c_str());
+  return ok;
+}
+
+void StStageIn::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    queued_.wait(lock, [&] {return stop_ || !queue_.empty();});
+    if (stop_)
+      break;
+    Job* job = queue_.front();
+    queue_.pop_front();
+    if (job->state != kQueued)
+      continue;
+    job->state = kCopying;
+    lock.unlock();
+
+    bool ok = Copy(*job);
+
+    lock.lock();
+    if (job->state == kRemoved) {
+      unlink(job->target.c_str());
+      continue;
+    }
+    if (ok) {
+      job->state = kStaged;
+      n_staged_++;
+      bytes_copied_ += job->size;
+    }
+    else {
+      job->state = kFailed;
+      reserved_bytes_ -= job->size;
+      n_failed_++;
+    }
+  }
+}
+
+void StStageIn::Print() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LOG_INFO << "stage-in: " << n_staged_ << " files staged (" << bytes_copied_ / (1024 * 1024) << " MB) in "
+           << dir_ << ", " << n_direct_ << " read in place, " << n_failed_ << " failed copies, "
+           << n_late_ << " copies finished too late" << endm;
+}
@@ -0,0 +1,117 @@
+/* internal class for StEfficiencyAssessor
+   copies the next few input files to local scratch space
+   on a background thread, while the current files are
+   being processed, so there is no remote read stall at
+   every file boundary
+
+   files are staged per stream: either a TChain, whose
+   upcoming file names are replaced by the staged copies
+   once the copies are complete, or a list of files that
+   follows a chain entry by entry (the paired miniMC files
+   of a muDst chain), looked up with Resolve(). Copies are
+   removed once their chain has moved past them. If a copy
+   would exceed the disk limit, or the file is remote, the
+   file is read in place instead (remote files are opened
+   ahead asynchronously). A chain whose file was swapped
+   gets its original name back when the copy is removed -
+   still, only chains read strictly in order should be
+   staged, since a chain that goes back to an earlier file
+   reads it in place
+
+   the thread only does posix I/O - all ROOT objects are
+   touched on the main thread, in Update()
+ */
+
+#ifndef STSTAGEIN__HH
+#define STSTAGEIN__HH
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "TChain.h"
+
+class TChainElement;
+
+class StStageIn {
+public:
+
+  /* files are copied to dir, at most lookahead files ahead
+     of the current file of each stream, using at most
+     maxBytes of disk
+   */
+  StStageIn(std::string dir, unsigned lookahead = 2, Long64_t maxBytes = 20000000000LL);
+  ~StStageIn();
+
+  /* stage the upcoming files of a chain, which must be read
+     in order
+   */
+  void AddChain(TChain* chain);
+
+  /* stage files[i] while follow is on (or just before) its
+     i-th file. Empty names are skipped
+   */
+  void AddFiles(const std::vector<std::string>& files, TChain* follow);
+
+  /* queues the next files of every stream, swaps finished
+     copies into their chains, and removes the copies of
+     files that are done. Cheap - call once per event
+   */
+  void Update();
+
+  /* staged copy of source, or source if it is not staged */
+  std::string Resolve(const std::string& source);
+
+  void Print();
+
+private:
+
+  enum State {kPending, kQueued, kCopying, kStaged, kDirect, kFailed, kRemoved};
+
+  struct Job {
+    std::string source;
+    std::string target;
+    TChainElement* element;  // whose title is swapped, if any
+    Long64_t size;
+    State state;
+    bool used;
+  };
+
+  struct Stream {
+    TChain* follow;
+    bool patch;
+    std::vector<Job*> jobs;
+  };
+
+  void AddStream(const std::vector<std::string>& files, TChain* follow, bool patch);
+  void Queue(Job* job);
+  void Remove(Job* job);
+  bool Copy(const Job& job);
+  void Run();
+
+  std::string dir_;
+  unsigned lookahead_;
+  Long64_t max_bytes_;
+  Long64_t reserved_bytes_;
+
+  std::vector<Stream> streams_;
+  std::vector<Job*> all_jobs_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable queued_;
+  std::deque<Job*> queue_;
+  std::atomic<bool> stop_;
+
+  Long64_t n_staged_;
+  Long64_t n_direct_;
+  Long64_t n_failed_;
+  Long64_t n_late_;
+  Long64_t bytes_copied_;
+};
+
+#endif // STSTAGEIN__HH
@@ -0,0 +1,26 @@
+ /* STAR Collaboration - Nick Elsey
+
+    Benchmark of the histogram fills in the event loop of
+    StEfficiencyAssessor: the matched-track histograms are
+    filled through TH3D::Fill, through StDenseHistogram and
+    through the StObservableGroups Make uses, on the same
+    generated events, and compared afterwards
+
+    arguments --
+    nEvents:       number of events to generate
+    nTracks:       matched tracks per event
+*/
+
+void benchmark_fill(int nEvents = 2000,
+                    int nTracks = 400)
+{
+  // load STAR libraries
+  gROOT->Macro("LoadLogger.C");
+  gROOT->Macro("loadMuDst.C");
+  gSystem->Load("StMiniMcEvent");
+  gSystem->Load("libStEfficiencyAssessor.so");
+
+  StFillBenchmark benchmark;
+  if (!benchmark.Run(nEvents, nTracks))
+    cout << "benchmark failed: the histograms differ" << endl;
+}
@@ -13,7 +13,8 @@
     muFileList:    list of filenames & paths to muDSTs
     mcFileList:    list of filenames & paths to corresponding miniMCs
     nametag:       identifier used in output file name
-    nFiles:        number of files to accept from the file list
+    nFiles:        number of muDST files to accept from the file list -
+                   only miniMC files that can match them are read
 */
 
 void efficiency_assessment(int nEvents = 1e9,
@@ -32,55 +33,70 @@ void efficiency_assessment(int nEvents = 1e9,
   gSystem->Load("libStEfficiencyAssessor.so");
   gSystem->Load("libStEfficiencyAssessor.so");
 
-  StChain* chain = new StChain("StChain");
-  StMuDstMaker* muDstMaker = new StMuDstMaker(0, 0, "", muFileList, "", nFiles);
-
-  // make StEfficiencyMaker
-  std::ifstream file(mcFileList);
-  TChain* mcChain = new TChain("StMiniMcTree");
-  std::string line;
-  while (std::getline(file, line)) {
-    mcChain->Add(line.c_str());
-  }
-  std::string outname = std::string(nametag) + ".root";
-  StEfficiencyAssessor* assessor = new StEfficiencyAssessor(mcChain, outname);
-  assessor->AddGeantId(8);
-  assessor->AddGeantId(9);
-  assessor->SetDCAMax(dcaMax);
-  assessor->SetMinFitPoints(fitPoints);
-  assessor->SetMinFitFrac(fitFrac);
-
-  // event cuts
-  assessor->EventCuts().AddTrigger(450010);
-  assessor->EventCuts().AddTrigger(450020);
-
-  // for each event, print the memory usage
-  // helpful for debugging
-  StMemStat memory;
-  memory.PrintMem(NULL);
-	
-  if (chain->Init()) { cout<<"StChain failed init: exiting"<<endl; return;}
-  cout << "chain initialized" << endl;
-	
-  TStopwatch total;
-  TStopwatch timer;
-	
-  int i=0;
-  while ( i < nEvents && chain->Make() == kStOk ) {
-    if ( i % 500 == 0 ) {
-      cout<<"done with event "<<i;
-      cout<<"\tcpu: "<<timer.CpuTime()<<"\treal: "<<timer.RealTime()<<"\tratio: "<<timer.CpuTime()/timer.RealTime();//<<endl;
-      timer.Start();
-      memory.PrintMem(NULL);
-    }
-    i++;
-    chain->Clear();
-  }
-  
-  chain->ls(3);
-  chain->Finish();
-  printf("my macro processed %i events in %s", i, nametag);
-  cout << "\tcpu: " << total.CpuTime() << "\treal: " << total.RealTime() << "\tratio: " << total.CpuTime() / total.RealTime() << endl;
+  // the chain, miniMC catalog, cuts & triggers are set up by the
+  // compiled StEfficiencyJob - the standalone efficiency_assessment
+  // executable runs the same job without the interpreter
+  StEfficiencyJob job(muFileList, mcFileList, nametag, dcaMax, fitPoints, fitFrac, nFiles);
+  if (!job.Setup()) { cout<<"job setup failed: exiting"<<endl; return;}
+  StEfficiencyAssessor* assessor = job.Assessor();
+
+  // miniMC event indices are cached next to the miniMC files; if those
+  // directories are not writable, point the cache somewhere persistent
+  // assessor->SetIndexDirectory("/path/to/index/cache");
+
+  // decode miniMC events on a second thread, ahead of the muDst - only
+  // with file pairing or an in-order match mode
+  // assessor->SetPrefetchDepth(16);
+
+  // open only the miniMC file with the run & sequence number of the
+  // current muDST file, instead of searching the whole miniMC chain
+  // assessor->PairByFile(true);
+
+  // when the embedding covers only part of the muDST events, iterate the
+  // miniMC events and read only their muDST partners
+  // assessor->SetMatchMode(StEfficiencyAssessor::kMiniMcDriven);
+
+  // copy the next input files to local scratch while the current ones
+  // are processed (at most 20 GB), instead of reading them from GPFS
+  // if (gSystem->Getenv("SCRATCH"))
+  //   assessor->SetStageIn(gSystem->Getenv("SCRATCH"), 2, 20000000000LL);
+
+  // histograms are written in Finish with a chosen compression - fast
+  // settings for scratch output, small ones for archived output, and
+  // one directory per histogram family
+  // assessor->SetOutputCompression(StHistogramWriter::ArchiveCompression());
+  // assessor->SetOutputLayout(StEfficiencyAssessor::kFamilyLayout);
+
+  // skip histogram families that are not needed - they are neither
+  // booked, filled nor written
+  // assessor->EnableFamily("data", false);
+
+  // the differential study in (lumi, cent, vz, pt, eta, phi) and dca, nhit
+  // & nhitposs, within 1 GB - the cubes are written as StDifferentialCube,
+  // plus their pt & (pt, eta) projections
+  // assessor->SetDifferentialOutput(true, 1000000000LL);
+  // assessor->AddDifferentialProjection("pt");
+  // assessor->AddDifferentialProjection("pt:eta");
+
+  // store the histograms as lists of their filled bins - read them back
+  // with StSparseHistogram::Get(file, name). Jobs merged with hadd must
+  // all use the same setting
+  // assessor->SetSparseOutput(true);
+
+  // a flat copy of the output for fast downstream reading, memory
+  // mapped with StFlatResult.hh - no ROOT needed
+  // assessor->SetFlatOutput(std::string(nametag) + ".flat");
+
+  // the efficiency in (cent, pt) bins as a compact table, looked up
+  // in constant time with StEfficiencyTable.hh
+  // assessor->SetEfficiencyOutput(std::string(nametag) + ".eff");
+
+  // save the job state every 10k events or 10 minutes - a job restarted
+  // with the same arguments continues from the last checkpoint
+  // assessor->SetCheckpoint(std::string(nametag) + ".checkpoint.root", 10000, 600);
+
+  // runs the event loop, printing timing & memory every 500 events
+  job.Run(nEvents);
 
   cout << endl;
   cout << "--------------" << endl;
@@ -0,0 +1,61 @@
+/* STAR Collaboration - Nick Elsey
+
+   Standalone, compiled version of efficiency_assessment.cxx -
+   takes the same arguments in the same order and writes the
+   same output, but the event loop runs natively instead of
+   through root4star's interpreter
+
+   built by macros/compile.csh (into libs/ and sandbox/), and
+   run after starver, with libStEfficiencyAssessor.so in the
+   library path or the working directory:
+
+     efficiency_assessment 1e9 mu.list mc.list tag 3.0 20 0.52 5
+
+   or as a long-lived worker, running the jobs of a queue
+   directory one after the other (see StEfficiencyWorker):
+
+     efficiency_assessment --worker /path/to/queue 600
+
+   The STAR libraries are loaded at startup the same way the
+   macro loads them, and the job itself is StEfficiencyJob
+*/
+
+#include "TROOT.h"
+#include "TSystem.h"
+
+#include <iostream>
+#include <string>
+
+typedef int (*JobMain)(int, char**);
+
+int main(int argc, char** argv) {
+  // root4star finds the STAR macros through its .rootrc
+  const char* star = gSystem->Getenv("STAR");
+  if (star != nullptr) {
+    std::string path = std::string(".:") + star + "/StRoot/macros:" + gROOT->GetMacroPath();
+    gROOT->SetMacroPath(path.c_str());
+  }
+
+  // load STAR libraries
+  gROOT->Macro("LoadLogger.C");
+  gROOT->Macro("loadMuDst.C");
+  gSystem->Load("StMiniMcEvent");
+  if (gSystem->Load("libStEfficiencyAssessor.so") < 0) {
+    std::cerr << "could not load libStEfficiencyAssessor.so" << std::endl;
+    return 1;
+  }
+
+  JobMain jobMain = (JobMain) gSystem->DynFindSymbol("*", "StEfficiencyJobMain");
+  if (jobMain == nullptr) {
+    std::cerr << "libStEfficiencyAssessor.so has no StEfficiencyJobMain" << std::endl;
+    return 1;
+  }
+  int ret = jobMain(argc, argv);
+
+  std::cout << std::endl;
+  std::cout << "--------------" << std::endl;
+  std::cout << " (-: Done :-) " << std::endl;
+  std::cout << "--------------" << std::endl;
+  std::cout << std::endl;
+  return ret;
+}
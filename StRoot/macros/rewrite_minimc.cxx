@@ -0,0 +1,44 @@
+ /* STAR Collaboration - Nick Elsey
+
+    Rewrites the miniMC files of a production in the event
+    order of the corresponding muDSTs, keeping only the
+    branches StEfficiencyAssessor reads. Point the mcFileList
+    of efficiency_assessment at the output, with the same
+    muFileList, and the miniMC input is read sequentially
+
+    arguments --
+    muFileList:    list of filenames & paths to muDSTs
+    mcFileList:    list of filenames & paths to corresponding miniMCs
+    outputFile:    rewritten miniMC file
+    compression:   ROOT compression settings (100 * algorithm + level),
+                   -1 for the default (LZ4 or zlib, fast levels)
+    keepUnmatched: append miniMC events without muDST partner
+*/
+
+void rewrite_minimc(const char* muFileList = "mutest.list",
+                    const char* mcFileList = "mctest.list",
+                    const char* outputFile = "minimc_sorted.root",
+                    int compression = -1,
+                    bool keepUnmatched = true)
+{
+  // load STAR libraries
+  gROOT->Macro("LoadLogger.C");
+  gROOT->Macro("loadMuDst.C");
+  gSystem->Load("StMiniMcEvent");
+  gSystem->Load("libStEfficiencyAssessor.so");
+
+  TStopwatch total;
+
+  StMiniMcRewriter* rewriter = new StMiniMcRewriter();
+  if (compression >= 0)
+    rewriter->SetCompressionSettings(compression);
+  rewriter->KeepUnmatched(keepUnmatched);
+
+  if (!rewriter->Rewrite(muFileList, mcFileList, outputFile)) {
+    cout << "miniMC rewrite failed" << endl;
+    return;
+  }
+
+  cout << "rewrote " << rewriter->EventsWritten() << " events to " << outputFile;
+  cout << "\tcpu: " << total.CpuTime() << "\treal: " << total.RealTime() << endl;
+}